@@ -0,0 +1,332 @@
+#include <bits/stdc++.h>
+#include <fcntl.h>
+
+#include "Course_Allocation.h"
+#include "Dynamic_Matching.h"
+#include "Input.h"
+#include "Least_Dissatisfaction.h"
+#include "Min_Spread.h"
+#include "Output.h"
+
+using namespace std;
+
+// One instance kept in memory with the maximal matching and every result computed so far,
+// so repeated queries only pay for what they have not asked before. Updates keep the Pareto optimal matching
+// up to date and serve it as the maximal matching from then on, the other results are computed again
+struct Allocation
+{
+    Graph graph;
+    int numPref;
+    vector<int> seats; // Seats of each course, 1 everywhere unless loaded as a course instance
+    int threads;
+    MatchingEngine engine;
+
+    vector<int> matchA, matchH; // Maximal matching
+    int maxMatchingSize;
+
+    bool leastDone = false, spreadDone = false, paretoDone = false, courseDone = false;
+    pair<int, vector<int>> least, spread;
+    SolverWorkspace solver; // Probe buffers shared by the least and spread queries, results are swapped out
+    vector<int> pareto, paretoH;
+    unique_ptr<DynamicMatching> live; // Created by the first update
+    MatchingUpdate pending;
+    vector<int> pendingSeats; // Seats of the houses added by the pending update
+    CourseMatching course;
+    int courseMax = 0, courseLeast = 0;
+
+    Allocation(Graph graph, int numPref, vector<int> seats, int threads, MatchingEngine engine)
+        : graph(move(graph)), numPref(numPref), seats(move(seats)), threads(threads), engine(engine)
+    {
+        maxMatchingSize = maximumMatching(this->graph, matchA, matchH, engine, threads);
+    }
+
+    void answerMax(OutputWriter &out)
+    {
+        out.note("Maximal Matching Size: " + to_string(maxMatchingSize));
+        out.assignments(matchA, graph);
+    }
+
+    void answerLeast(OutputWriter &out)
+    {
+        if (!leastDone)
+        {
+            least.first = leastDissatisfaction(graph, maxMatchingSize, solver, engine, threads);
+            makeCoalitionFree(solver.matchA, solver.matchH, graph);
+            least.second.swap(solver.matchA);
+            leastDone = true;
+        }
+        out.note("Maximal Matching Size: " + to_string(maxMatchingSize));
+        out.note("Least Dissatisfaction Matching Size: " + to_string(least.first));
+        out.assignments(least.second, graph);
+    }
+
+    void answerSpread(OutputWriter &out)
+    {
+        if (!spreadDone)
+        {
+            spread.first = minSpread(graph, maxMatchingSize, numPref, threads, solver, engine);
+            spread.second.swap(solver.bestA);
+            spreadDone = true;
+        }
+        out.note("Maximal Matching Size: " + to_string(maxMatchingSize));
+        out.note("Minimum Spread: " + to_string(spread.first));
+        out.assignments(spread.second, graph);
+    }
+
+    void computePareto()
+    {
+        if (!paretoDone)
+        {
+            // Start from a copy of the maximal matching, which stays as it is for the other queries
+            pareto = matchA;
+            paretoH = matchH;
+            makeTradeInFree(pareto, paretoH, graph, solver.tradeIn);
+            makeCoalitionFree(pareto, paretoH, graph);
+            paretoDone = true;
+        }
+    }
+
+    void answerPareto(OutputWriter &out)
+    {
+        computePareto();
+        out.note("Pareto Optimal Matching:");
+        out.assignments(pareto, graph);
+    }
+
+    void answerCourse(OutputWriter &out)
+    {
+        if (!courseDone)
+        {
+            courseMax = courseHopcroftKarp(graph, seats, course);
+            courseLeast = leastDissatisfaction(graph, seats, courseMax, course);
+            makeCoalitionFree(course, graph);
+            courseDone = true;
+        }
+        out.note("Maximal Matching : " + to_string(courseMax));
+        out.note("Least Dissatisfaction Matching Size: " + to_string(courseLeast));
+        out.assignments(course.matchA, graph, "Student", "Subject");
+        out.note("Unallocated Students: " + to_string(count(course.matchA.begin() + 1, course.matchA.end(), 0)));
+    }
+
+    // Queue one update line, returns false when the command is not an update. Throws runtime_error when
+    // the arguments of an update do not parse, the line is then dropped on its own
+    bool queueUpdate(const string &command, istringstream &args)
+    {
+        int id;
+        if (command == "agent")
+        {
+            if (!(args >> id))
+                throw runtime_error("agent needs an agent id");
+            vector<int> prefs;
+            for (int h; args >> h;)
+            {
+                prefs.push_back(h);
+            }
+            expectEnd(command, args);
+            pending.lists.push_back({id, move(prefs)});
+        }
+        else if (command == "withdraw-agent")
+        {
+            if (!(args >> id))
+                throw runtime_error("withdraw-agent needs an agent id");
+            expectEnd(command, args);
+            pending.withdrawnAgents.push_back(id);
+        }
+        else if (command == "withdraw-house")
+        {
+            if (!(args >> id))
+                throw runtime_error("withdraw-house needs a house id");
+            expectEnd(command, args);
+            pending.withdrawnHouses.push_back(id);
+        }
+        else if (command == "house")
+        {
+            int count = 1;
+            if (!(args >> count))
+            {
+                count = 1;
+            }
+            expectEnd(command, args);
+            if (count < 0)
+                throw runtime_error("house seats " + to_string(count) + " are negative");
+            pending.addedHouses++;
+            pendingSeats.push_back(count);
+        }
+        else
+            return false;
+        return true;
+    }
+
+    // Throws when an update line goes on after its arguments
+    static void expectEnd(const string &command, istringstream &args)
+    {
+        args.clear();
+        string rest;
+        if (args >> rest)
+        {
+            throw runtime_error("unexpected \"" + rest + "\" after " + command);
+        }
+    }
+
+    // Apply the queued updates before answering a query
+    void applyPending(OutputWriter &out)
+    {
+        if (pending.empty())
+        {
+            return;
+        }
+        if (!live)
+        {
+            computePareto();
+            live = make_unique<DynamicMatching>(graph, pareto, paretoH);
+        }
+        try
+        {
+            maxMatchingSize = applyUpdate(*live, pending);
+            matchA = pareto;
+            matchH = paretoH;
+            seats.insert(seats.end(), pendingSeats.begin(), pendingSeats.end());
+            for (int h : pending.withdrawnHouses)
+            {
+                seats[h] = 0;
+            }
+            numPref = graph.longestList();
+            leastDone = spreadDone = courseDone = false;
+        }
+        catch (const runtime_error &e)
+        {
+            out.note("Invalid update, dropped: " + string(e.what()));
+        }
+        pending = MatchingUpdate();
+        pendingSeats.clear();
+    }
+};
+
+// Usage: Allocation_Server [--courses] [--threads N] [--engine hopcroft-karp|push-relabel|pothen-fan] instance
+// Loads the instance once, then answers one query per line on stdin until "quit" or end of input:
+//   max | least | spread | pareto | course
+// Each reply is the text report of the matching program, ended by a line holding a single "."
+// With --courses the instance carries the seat line of Course_Allocation, otherwise every house has one seat.
+// Update lines are queued with an empty reply and applied together before the next query:
+//   agent a h1 h2 ...   new preference list of agent a, a = numAgents + 1 adds an agent
+//   withdraw-agent a | house [seats] | withdraw-house h
+int main(int argc, char **argv)
+{
+    bool courses = false;
+    int threads = 1;
+    MatchingEngine engine = MatchingEngine::HopcroftKarp;
+    const char *path = nullptr;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (string(argv[i]) == "--courses")
+        {
+            courses = true;
+        }
+        else if (string(argv[i]) == "--threads" && i + 1 < argc)
+        {
+            threads = atoi(argv[++i]);
+        }
+        else if (string(argv[i]) == "--engine" && i + 1 < argc)
+        {
+            if (!parseMatchingEngine(argv[++i], engine))
+            {
+                cerr << "Unknown matching engine: " << argv[i] << endl;
+                return 1;
+            }
+        }
+        else
+        {
+            path = argv[i];
+        }
+    }
+    if (!path)
+    {
+        cerr << "Usage: Allocation_Server [--courses] [--threads N] [--engine name] instance" << endl;
+        return 1;
+    }
+    if (threads <= 0)
+    {
+        threads = max(1u, thread::hardware_concurrency());
+    }
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        cerr << "Cannot open " << path << endl;
+        return 1;
+    }
+    int numPref;
+    vector<int> seats;
+    Graph graph(0, 0);
+    try
+    {
+        loadInstance(fd, graph, numPref, courses ? &seats : nullptr);
+    }
+    catch (const runtime_error &e)
+    {
+        cerr << "Invalid input: " << e.what() << endl;
+        return 1;
+    }
+    close(fd);
+    if (courses)
+    {
+        preprocessGraph(graph, seats);
+    }
+    else
+    {
+        seats.assign(graph.numHouses + 1, 1);
+        seats[0] = 0;
+    }
+
+    Allocation state(move(graph), numPref, move(seats), threads, engine);
+    OutputWriter out(OutputFormat::Text);
+    string line;
+    while (getline(cin, line))
+    {
+        string command;
+        istringstream args(line);
+        args >> command;
+        if (command.empty())
+        {
+            continue;
+        }
+        if (command == "quit")
+        {
+            break;
+        }
+        try
+        {
+            if (state.queueUpdate(command, args))
+            {
+                out.note(".");
+                out.flush();
+                continue;
+            }
+        }
+        catch (const runtime_error &e)
+        {
+            out.note("Invalid update, dropped: " + string(e.what()));
+            out.note(".");
+            out.flush();
+            continue;
+        }
+        state.applyPending(out);
+        if (command == "max")
+            state.answerMax(out);
+        else if (command == "least")
+            state.answerLeast(out);
+        else if (command == "spread")
+            state.answerSpread(out);
+        else if (command == "pareto")
+            state.answerPareto(out);
+        else if (command == "course")
+            state.answerCourse(out);
+        else
+            out.note("Unknown query: " + command);
+        out.note(".");
+        out.flush();
+    }
+
+    reportStats(); // Only with -DMATCHING_STATS
+    return 0;
+}
@@ -0,0 +1,173 @@
+#pragma once
+#include <dirent.h>
+#include <fcntl.h>
+
+#include "Input.h"
+#include "Output.h"
+
+using namespace std;
+
+// One instance of a batch, its buffers are kept by the worker for the next instance it reads. The graph takes
+// the id widths of each instance, solvers visit it
+struct BatchInstance
+{
+    AnyGraph graph;
+    int numPref = 0;
+    vector<int> seats;
+};
+
+// Regular files of a directory, sorted by name
+vector<string> listInstances(const string &dir)
+{
+    vector<string> files;
+    if (DIR *d = opendir(dir.c_str()))
+    {
+        while (dirent *entry = readdir(d))
+        {
+            string path = dir + "/" + entry->d_name;
+            struct stat st;
+            if (stat(path.c_str(), &st) == 0 && S_ISREG(st.st_mode))
+            {
+                files.push_back(path);
+            }
+        }
+        closedir(d);
+    }
+    sort(files.begin(), files.end());
+    return files;
+}
+
+// Solve many instances on a pool of 'threads' workers. Instances are read one after the other from stdin, or
+// from the files of 'dir' in name order, which may also be binary instances, with the seat line when
+// 'withSeats' is set. Workers take the next instance as soon as they are done with one, load it into their own
+// BatchInstance and call solve(instance, workspace, out), with one Workspace each kept for every instance they
+// take. Each report is written to stdout in input order, ended by a line holding a single "." unless the format
+// is binary, and notes of machine-readable formats and the errors of unreadable instances go to stderr in the
+// same order. Returns 1 when some instance could not be read. A stream that cannot be read stops there, a
+// directory goes on with the next file
+template <class Workspace, class Solve>
+int runBatch(const string &dir, bool withSeats, OutputFormat format, int threads, Solve solve)
+{
+    vector<string> files;
+    unique_ptr<InputReader> stream;
+    if (dir.empty())
+    {
+        stream = make_unique<InputReader>(STDIN_FILENO);
+    }
+    else
+    {
+        files = listInstances(dir);
+    }
+
+    mutex inputLock, outputLock;
+    int nextInput = 0, nextOutput = 0;
+    bool streamBroken = false;
+    atomic<bool> failed{false};
+    map<int, pair<string, string>> finished; // Reports waiting for the ones before them
+
+    auto deliver = [&](int index, string report, string notes)
+    {
+        lock_guard<mutex> guard(outputLock);
+        finished.emplace(index, make_pair(move(report), move(notes)));
+        for (auto it = finished.find(nextOutput); it != finished.end(); it = finished.find(++nextOutput))
+        {
+            fwrite(it->second.first.data(), 1, it->second.first.size(), stdout);
+            if (!it->second.second.empty())
+            {
+                fflush(stdout); // Keeps the order when both streams go to one place
+                fputs(it->second.second.c_str(), stderr);
+            }
+            finished.erase(it);
+        }
+        fflush(stdout);
+    };
+
+    auto worker = [&]()
+    {
+        BatchInstance instance;
+        Workspace workspace;
+        vector<int> *seats = withSeats ? &instance.seats : nullptr;
+        while (true)
+        {
+            int index;
+            string error;
+            if (stream)
+            {
+                lock_guard<mutex> guard(inputLock);
+                if (streamBroken || stream->atEnd())
+                {
+                    break;
+                }
+                index = nextInput++;
+                try
+                {
+                    guardAllocation([&]()
+                                    { readInstance(*stream, instance.graph, instance.numPref, seats); });
+                }
+                catch (const runtime_error &e)
+                {
+                    error = e.what();
+                    streamBroken = true; // Where the next instance starts is unknown
+                }
+            }
+            else
+            {
+                {
+                    lock_guard<mutex> guard(inputLock);
+                    index = nextInput++;
+                }
+                if (index >= (int)files.size())
+                {
+                    break;
+                }
+                int fd = open(files[index].c_str(), O_RDONLY);
+                if (fd < 0)
+                {
+                    error = "cannot open " + files[index];
+                }
+                else
+                {
+                    try
+                    {
+                        loadInstance(fd, instance.graph, instance.numPref, seats);
+                    }
+                    catch (const runtime_error &e)
+                    {
+                        error = files[index] + ": " + e.what();
+                    }
+                    close(fd);
+                }
+            }
+
+            OutputWriter out(format, nullptr);
+            string notes;
+            if (error.empty())
+            {
+                solve(instance, workspace, out);
+                notes = out.takeNotes();
+            }
+            else
+            {
+                failed = true;
+                notes = "Instance " + to_string(index + 1) + ": invalid input: " + error + "\n";
+            }
+            if (format != OutputFormat::Binary)
+            {
+                out.text(".\n");
+            }
+            deliver(index, out.takeReport(), move(notes));
+        }
+    };
+
+    vector<thread> pool;
+    for (int t = 1; t < threads; t++)
+    {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (thread &t : pool)
+    {
+        t.join();
+    }
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,205 @@
+#include <bits/stdc++.h>
+#include <sys/resource.h>
+
+#include "Course_Allocation.h"
+#include "Least_Dissatisfaction.h"
+#include "Min_Spread.h"
+
+using namespace std;
+
+// Draws houses 1..numHouses, either uniformly or with probability proportional to 1 / rank^exponent
+class HouseSampler
+{
+public:
+    HouseSampler(int numHouses, double exponent) : numHouses(numHouses)
+    {
+        if (exponent > 0)
+        {
+            cdf.resize(numHouses);
+            double sum = 0;
+            for (int h = 0; h < numHouses; ++h)
+            {
+                sum += 1 / pow(h + 1, exponent);
+                cdf[h] = sum;
+            }
+        }
+    }
+    int operator()(mt19937_64 &rng) const
+    {
+        if (cdf.empty())
+        {
+            return uniform_int_distribution<int>(1, numHouses)(rng);
+        }
+        double x = uniform_real_distribution<double>(0, cdf.back())(rng);
+        return min<int>(lower_bound(cdf.begin(), cdf.end(), x) - cdf.begin(), numHouses - 1) + 1;
+    }
+
+private:
+    int numHouses;
+    vector<double> cdf;
+};
+
+// Fill every preference list with numPref distinct houses from the sampler. With a master list the houses
+// of each agent are then ordered by one ranking shared by everybody
+void fillPreferences(Graph &graph, int numPref, const HouseSampler &sample, bool masterList, mt19937_64 &rng)
+{
+    vector<int> master(graph.numHouses + 1), seen(graph.numHouses + 1, 0);
+    iota(master.begin(), master.end(), 0);
+    shuffle(master.begin() + 1, master.end(), rng);
+    for (int a = 1; a <= graph.numAgents; ++a)
+    {
+        int *row = graph.house.data() + graph.offset[a];
+        for (int i = 0; i < numPref; ++i)
+        {
+            int h = sample(rng);
+            while (seen[h] == a)
+            {
+                h = h % graph.numHouses + 1; // Popular houses are drawn again often, take the next one instead
+            }
+            seen[h] = a;
+            row[i] = h;
+        }
+        if (masterList)
+        {
+            sort(row, row + numPref, [&](int x, int y)
+                 { return master[x] < master[y]; });
+        }
+    }
+    graph.indexRanks();
+}
+
+// Peak resident set size of the process so far, in KiB
+long peakRssKb()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+// Times phases of one instance and prints one JSON object per phase
+struct Report
+{
+    string generator, engine;
+    const Graph &graph;
+    int numPref;
+    unsigned long long seed;
+
+    template <class Phase>
+    void run(const char *name, Phase phase)
+    {
+        auto start = chrono::steady_clock::now();
+        long long result = phase();
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        printf("{\"generator\":\"%s\",\"engine\":\"%s\",\"agents\":%d,\"houses\":%d,\"prefs\":%d,\"edges\":%zu,\"seed\":%llu,"
+               "\"phase\":\"%s\",\"result\":%lld,\"seconds\":%.6f,\"edgesPerSecond\":%.0f,\"peakRssKb\":%ld}\n",
+               generator.c_str(), engine.c_str(), graph.numAgents, graph.numHouses, numPref, graph.house.size(), seed,
+               name, result, seconds, seconds > 0 ? graph.house.size() / seconds : 0.0, peakRssKb());
+        fflush(stdout);
+    }
+};
+
+// Usage: Benchmark [--gen uniform|zipf|master|course] [--agents N,...] [--houses H] [--prefs P] [--zipf S]
+//                  [--seed S] [--threads T] [--engine hopcroft-karp|push-relabel|pothen-fan]
+// Houses default to the number of agents, or one course per 50 students with --gen course. Agent counts default
+// to 1000,10000,100000. Results go to stdout as JSON lines, one per phase
+int main(int argc, char **argv)
+{
+    string generator = "uniform";
+    vector<int> sizes = {1000, 10000, 100000};
+    int numHouses = 0, numPref = 10, threads = 1;
+    double exponent = 1.0;
+    unsigned long long seed = 1;
+    string engineName = "hopcroft-karp";
+    MatchingEngine engine = MatchingEngine::HopcroftKarp;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        string option = argv[i], value = argv[i + 1];
+        if (option == "--gen")
+            generator = value;
+        else if (option == "--agents")
+        {
+            sizes.clear();
+            stringstream list(value);
+            for (string n; getline(list, n, ',');)
+            {
+                sizes.push_back(stoi(n));
+            }
+        }
+        else if (option == "--houses")
+            numHouses = stoi(value);
+        else if (option == "--prefs")
+            numPref = stoi(value);
+        else if (option == "--zipf")
+            exponent = stod(value);
+        else if (option == "--seed")
+            seed = stoull(value);
+        else if (option == "--threads")
+            threads = max(1, stoi(value));
+        else if (option == "--engine")
+        {
+            engineName = value;
+            if (!parseMatchingEngine(value, engine))
+            {
+                cerr << "Unknown matching engine: " << value << endl;
+                return 1;
+            }
+        }
+        else
+        {
+            cerr << "Unknown option: " << option << endl;
+            return 1;
+        }
+    }
+    if (generator != "uniform" && generator != "zipf" && generator != "master" && generator != "course")
+    {
+        cerr << "Unknown generator: " << generator << endl;
+        return 1;
+    }
+
+    for (int numAgents : sizes)
+    {
+        int houses = numHouses > 0 ? numHouses : generator == "course" ? max(1, numAgents / 50) : numAgents;
+        int prefs = min(numPref, houses);
+        mt19937_64 rng(seed);
+        Graph graph(numAgents, houses, prefs);
+        HouseSampler sample(houses, generator == "zipf" || generator == "course" ? exponent : 0);
+        fillPreferences(graph, prefs, sample, generator == "master", rng);
+        Report report{generator, generator == "course" ? "course" : engineName, graph, prefs, seed};
+
+        if (generator == "course")
+        {
+            // About one seat per student, handed out with the same skew as the popularity of the courses
+            vector<int> seats(houses + 1, 1);
+            for (int s = houses; s < numAgents; ++s)
+            {
+                seats[sample(rng)]++;
+            }
+            CourseMatching m;
+            int maxMatchingSize = 0;
+            report.run("courseHopcroftKarp", [&]
+                       { return maxMatchingSize = courseHopcroftKarp(graph, seats, m); });
+            report.run("leastDissatisfaction", [&]
+                       { return leastDissatisfaction(graph, seats, maxMatchingSize, m); });
+            report.run("makeCoalitionFree", [&]
+                       { makeCoalitionFree(m, graph); return 0; });
+            continue;
+        }
+
+        vector<int> matchA, matchH;
+        SolverWorkspace solver;
+        int maxMatchingSize = 0;
+        report.run("maximumMatching", [&]
+                   { return maxMatchingSize = maximumMatching(graph, matchA, matchH, engine, threads); });
+        report.run("leastDissatisfaction", [&]
+                   { return leastDissatisfaction(graph, maxMatchingSize, solver, engine, threads); });
+        report.run("minSpread", [&]
+                   { return minSpread(graph, maxMatchingSize, prefs, threads, solver, engine); });
+        report.run("makeTradeInFree", [&]
+                   { makeTradeInFree(matchA, matchH, graph, solver.tradeIn); return 0; });
+        report.run("makeCoalitionFree", [&]
+                   { makeCoalitionFree(matchA, matchH, graph); return 0; });
+    }
+
+    reportStats(); // Only with -DMATCHING_STATS
+    return 0;
+}
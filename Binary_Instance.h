@@ -0,0 +1,224 @@
+#pragma once
+#include <cstring>
+
+#include "Graph.h"
+
+using namespace std;
+
+// Binary instance format, written from the text format by Instance_Converter. A fixed header is followed by
+// sections that each start at a multiple of binaryAlign bytes from the start of the file and hold native
+// integers: seats[0 .. numHouses] when flags has BinaryHasSeats (seats[0] unused), offset[0 .. numAgents + 1] and
+// house[0 .. edges - 1] exactly as in BasicGraph, and when flags has BinaryHasRanks the (house, rank) pairs of the
+// sparse RankIndex. House ids take 16 bits with BinaryHouse16 and offsets 64 bits with BinaryOffset64, 32 bits
+// otherwise, as in version 1 which had neither. A mapped file is used as the graph in place after one checking
+// pass, nothing is parsed or copied
+const char binaryMagic[8] = {'P', 'R', 'E', 'F', 'B', 'I', 'N', '\0'};
+constexpr uint32_t binaryVersion = 2;
+constexpr size_t binaryAlign = 64;
+
+constexpr uint32_t BinaryHasSeats = 1, BinaryHasRanks = 2, BinaryHouse16 = 4, BinaryOffset64 = 8; // Header flags
+
+struct BinaryHeader
+{
+    char magic[8];
+    uint32_t version, flags;
+    int64_t numAgents, numHouses, numPref, edges;
+    int64_t seatsAt, offsetAt, houseAt, ranksAt; // Byte positions of the sections, 0 when absent
+};
+
+bool isBinaryInstance(const char *data, size_t size)
+{
+    return size >= sizeof binaryMagic && memcmp(data, binaryMagic, sizeof binaryMagic) == 0;
+}
+
+// Header of the binary instance in data[0 .. size), with its counts checked against the id widths it declares
+BinaryHeader readBinaryHeader(const char *data, size_t size)
+{
+    BinaryHeader header;
+    if (size < sizeof header)
+    {
+        throw runtime_error("truncated binary header");
+    }
+    memcpy(&header, data, sizeof header);
+    if (header.version == 1)
+    {
+        header.flags &= ~(BinaryHouse16 | BinaryOffset64);
+    }
+    else if (header.version != binaryVersion)
+    {
+        throw runtime_error("binary format version " + to_string(header.version) + " not supported");
+    }
+    int64_t maxHouses = header.flags & BinaryHouse16 ? UINT16_MAX : INT_MAX - 2;
+    int64_t maxEdges = header.flags & BinaryOffset64 ? INT64_MAX : INT_MAX;
+    if (header.numAgents < 0 || header.numAgents > INT_MAX - 2 || header.numHouses < 0 || header.numHouses > maxHouses ||
+        header.numPref < 0 || header.numPref > INT_MAX || header.edges < 0 || header.edges > maxEdges)
+    {
+        throw runtime_error("binary header counts out of range");
+    }
+    return header;
+}
+
+// One sequential pass over the sections of a binary instance, so a corrupted file is reported like a bad text
+// instance instead of being indexed out of bounds later: offsets start at 0, never decrease and end at the edge
+// count, house ids lie in [1, numHouses], rank pairs name a house in range at a rank inside the list and seat
+// counts are not negative. Throws runtime_error
+template <class House, class Offset>
+void checkBinaryLists(int numAgents, int numHouses, const Offset *offset, const House *house, const pair<int, int> *pairs, const int *seats)
+{
+    if (offset[0] != 0 || offset[1] != 0)
+    {
+        throw runtime_error("binary offsets do not start at 0");
+    }
+    for (int a = 1; a <= numAgents; ++a)
+    {
+        if (offset[a + 1] < offset[a])
+        {
+            throw runtime_error("binary offsets decrease at agent " + to_string(a));
+        }
+    }
+    for (int a = 1; a <= numAgents; ++a) // Every list lies inside the house section now
+    {
+        for (Offset i = offset[a]; i < offset[a + 1]; ++i)
+        {
+            if (house[i] < 1 || house[i] > numHouses)
+            {
+                throw runtime_error("binary house id " + to_string(house[i]) + " of agent " + to_string(a) + " not in [1, " +
+                                    to_string(numHouses) + "]");
+            }
+            if (pairs && (pairs[i].first < 1 || pairs[i].first > numHouses || pairs[i].second < 0 || pairs[i].second >= offset[a + 1] - offset[a]))
+            {
+                throw runtime_error("binary rank pair of agent " + to_string(a) + " out of range");
+            }
+        }
+    }
+    for (int h = 1; seats && h <= numHouses; ++h)
+    {
+        if (seats[h] < 0)
+        {
+            throw runtime_error("binary seat count of house " + to_string(h) + " is negative");
+        }
+    }
+}
+
+// Make graph a view of the binary instance in data[0 .. size), which 'keep' holds alive. The instance must be
+// stored with the id widths of G. Every section is checked by checkBinaryLists before it is used. Throws
+// runtime_error
+template <class G>
+void viewBinaryInstance(const char *data, size_t size, shared_ptr<const void> keep, G &graph, int &numPref, vector<int> *seats = nullptr)
+{
+    using House = typename G::HouseType;
+    using Offset = typename G::OffsetType;
+    BinaryHeader header = readBinaryHeader(data, size);
+    if (bool(header.flags & BinaryHouse16) != (sizeof(House) == 2) || bool(header.flags & BinaryOffset64) != (sizeof(Offset) == 8))
+    {
+        throw runtime_error("binary instance stored with other id widths");
+    }
+    auto section = [&](int64_t at, int64_t count, size_t width, const char *what)
+    {
+        if (at <= 0 || at % binaryAlign != 0 || (uint64_t)at > size || (size - at) / width < (uint64_t)count)
+        {
+            throw runtime_error(string("binary ") + what + " section out of bounds");
+        }
+        return data + at;
+    };
+    int numAgents = header.numAgents, numHouses = header.numHouses;
+    int64_t edges = header.edges;
+    auto offset = (const Offset *)section(header.offsetAt, numAgents + 2, sizeof(Offset), "offset");
+    auto house = (const House *)section(header.houseAt, edges, sizeof(House), "house");
+    if (offset[numAgents + 1] != edges)
+    {
+        throw runtime_error("binary offsets do not end at the edge count");
+    }
+    if (seats && !(header.flags & BinaryHasSeats))
+    {
+        throw runtime_error("binary instance has no seat counts");
+    }
+    auto firstSeat = seats ? (const int *)section(header.seatsAt, numHouses + 1, sizeof(int), "seat") : nullptr;
+    bool adoptRanks = (header.flags & BinaryHasRanks) && !RankIndex<Offset>::wantsDense(numAgents, numHouses, edges);
+    auto pairs = adoptRanks ? (const pair<int, int> *)section(header.ranksAt, edges, sizeof(pair<int, int>), "rank") : nullptr;
+    checkBinaryLists(numAgents, numHouses, offset, house, pairs, firstSeat);
+    if (seats)
+    {
+        seats->assign(firstSeat, firstSeat + numHouses + 1);
+    }
+
+    graph.numAgents = numAgents;
+    graph.numHouses = numHouses;
+    graph.offset = Buffer<Offset>(offset, numAgents + 2, keep);
+    graph.house = Buffer<House>(house, edges, keep);
+    if (adoptRanks)
+    {
+        graph.ranks.adopt(numHouses, graph.offset, Buffer<pair<int, int>>(pairs, edges, keep));
+    }
+    else
+    {
+        graph.indexRanks(); // The dense table is small, building it costs less than storing it
+    }
+    numPref = header.numPref;
+}
+
+// Same, with graph switched to the widths the instance was stored with
+void viewBinaryInstance(const char *data, size_t size, shared_ptr<const void> keep, AnyGraph &graph, int &numPref, vector<int> *seats = nullptr)
+{
+    BinaryHeader header = readBinaryHeader(data, size);
+    // The largest sizes the stored widths are meant for
+    chooseWidths(graph, header.flags & BinaryHouse16 ? UINT16_MAX : INT_MAX, header.flags & BinaryOffset64 ? INT64_MAX : INT_MAX);
+    visit([&](auto &g)
+          { viewBinaryInstance(data, size, keep, g, numPref, seats); },
+          graph);
+}
+
+// Write graph with its id widths, its sparse rank index if it has one and the seat counts when given in the binary
+// format. Returns false when the file could not be written
+template <class G>
+bool writeBinaryInstance(FILE *file, const G &graph, int numPref, const vector<int> *seats = nullptr)
+{
+    using House = typename G::HouseType;
+    using Offset = typename G::OffsetType;
+    size_t edges = graph.house.size();
+    bool withRanks = !graph.ranks.isDense();
+    BinaryHeader header{};
+    memcpy(header.magic, binaryMagic, sizeof binaryMagic);
+    header.version = binaryVersion;
+    header.flags = (seats ? BinaryHasSeats : 0) | (withRanks ? BinaryHasRanks : 0) | (sizeof(House) == 2 ? BinaryHouse16 : 0) |
+                   (sizeof(Offset) == 8 ? BinaryOffset64 : 0);
+    header.numAgents = graph.numAgents;
+    header.numHouses = graph.numHouses;
+    header.numPref = numPref;
+    header.edges = edges;
+
+    int64_t pos = 0;
+    auto place = [&](size_t bytes)
+    {
+        pos = (pos + binaryAlign - 1) / binaryAlign * binaryAlign;
+        int64_t at = pos;
+        pos += bytes;
+        return at;
+    };
+    place(sizeof header);
+    header.seatsAt = seats ? place((graph.numHouses + 1) * sizeof(int)) : 0;
+    header.offsetAt = place(graph.offset.size() * sizeof(Offset));
+    header.houseAt = place(edges * sizeof(House));
+    header.ranksAt = withRanks ? place(edges * sizeof(pair<int, int>)) : 0;
+
+    int64_t written = 0;
+    auto put = [&](int64_t at, const void *bytes, size_t n)
+    {
+        static const char zeros[binaryAlign] = {};
+        bool ok = fwrite(zeros, 1, at - written, file) == size_t(at - written) && fwrite(bytes, 1, n, file) == n;
+        written = at + n;
+        return ok;
+    };
+    bool ok = put(0, &header, sizeof header);
+    if (seats)
+    {
+        ok = ok && put(header.seatsAt, seats->data(), (graph.numHouses + 1) * sizeof(int));
+    }
+    ok = ok && put(header.offsetAt, graph.offset.data(), graph.offset.size() * sizeof(Offset));
+    ok = ok && put(header.houseAt, graph.house.data(), edges * sizeof(House));
+    if (withRanks)
+    {
+        ok = ok && put(header.ranksAt, graph.ranks.sortedPairs().data(), edges * sizeof(pair<int, int>));
+    }
+    return fflush(file) == 0 && ok;
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include "Course_Matching.h"
+
+using namespace std;
+
+// Sweep k upwards, widening the window to the top 'k' preferences and augmenting the previous matching,
+// until the matching reaches the maximal matching size. m is emptied first and receives the matching
+template <class G>
+int leastDissatisfaction(const G &graph, const vector<int> &seats, int maxMatchingSize, CourseMatching &m)
+{
+    STAT_PHASE("leastDissatisfaction");
+    m.reset(graph, seats);
+    int matchingSize = 0;
+    int longest = graph.longestList();
+    for (int k = 1; k <= longest; ++k)
+    {
+        // The matching of the previous step stays valid, only augment from it
+        matchingSize += augmentCourseMatching(RankWindow(graph, 0, k), m);
+        STAT_ADD(windowProbes, 1);
+
+        if (matchingSize == maxMatchingSize)
+        {
+            return k;
+        }
+    }
+
+    return 0;
+}
+
+template <class G>
+void preprocessGraph(const G &graph, vector<int> &seats)
+{
+    for (int i = 1; i <= graph.numHouses; ++i)
+    {
+        seats[i] = min(seats[i], graph.numAgents); // Ensure seats do not exceed number of students
+    }
+}
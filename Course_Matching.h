@@ -0,0 +1,325 @@
+#pragma once
+#include "Pareto.h"
+#include "Stats.h"
+
+using namespace std;
+
+// Matching in which course h holds up to seats[h] students, one node per course whatever its size.
+// The students of course h sit in holder[start[h]] .. holder[start[h] + load[h] - 1], slot[a] is where student a sits
+struct CourseMatching
+{
+    vector<int> matchA; // Course of each student, 0 if unassigned
+    vector<int> load;   // Occupied seats of each course
+    vector<int64_t> start; // First slot of each course, start[numCourses + 1] is the total number of slots
+    vector<int> holder;    // Student sitting in each slot
+    vector<int64_t> slot;  // Slot of each student
+
+    // Scratch of augmentCourseMatching, kept for every probe of the run and for the next run
+    vector<int> dist, distC, it, cur, path, queue;
+    int base = 1; // Layers are numbered from here, see courseBfs
+
+    CourseMatching() = default;
+    template <class Window>
+    CourseMatching(const Window &graph, const vector<int> &seats) { reset(graph, seats); }
+
+    // Empty the matching, reusing the buffers of a previous run. Course h gets min(seats[h], entries ranking h)
+    // slots, no more students can ever sit in it, so the slots follow the demand and not the seat counts.
+    // A negative seat count gives no slots
+    template <class Window>
+    void reset(const Window &graph, const vector<int> &seats)
+    {
+        int numStudents = graph.numAgents;
+        matchA.assign(numStudents + 1, 0);
+        slot.assign(numStudents + 1, -1);
+        load.assign(seats.size(), 0);
+        start.assign(seats.size() + 1, 0);
+        for (int a = 1; a <= numStudents; ++a)
+        {
+            for (int h : graph.prefs(a))
+            {
+                start[h + 1]++;
+            }
+        }
+        for (size_t h = 1; h < seats.size(); ++h)
+        {
+            start[h + 1] = start[h] + max<int64_t>(0, min<int64_t>(seats[h], start[h + 1]));
+        }
+        holder.assign(start.back(), 0);
+    }
+
+    int capacity(int h) const { return int(start[h + 1] - start[h]); }
+    bool full(int h) const { return load[h] == capacity(h); }
+
+    // Student a takes slot s of course h, the previous holder of s has already moved on
+    void take(int a, int h, int64_t s)
+    {
+        holder[s] = a;
+        slot[a] = s;
+        matchA[a] = h;
+    }
+    // Student a takes a free seat of course h
+    void seat(int a, int h) { take(a, h, start[h] + load[h]++); }
+
+    // Grow the scratch to the instance, it only ever grows
+    void prepare(int numStudents, int numCourses)
+    {
+        if ((int)dist.size() < numStudents + 1)
+        {
+            dist.resize(numStudents + 1, 0); // Below base, unreached
+            it.resize(numStudents + 1);
+        }
+        if ((int)distC.size() < numCourses + 1)
+        {
+            distC.resize(numCourses + 1, 0);
+            cur.resize(numCourses + 1);
+        }
+        path.reserve(numStudents + 1);
+        queue.reserve(numStudents + 1);
+    }
+
+    // Lay the slots out again after matchA was changed directly, one pass filling each course's slots in order
+    void rebuildSlots()
+    {
+        fill(load.begin(), load.end(), 0);
+        for (int a = 1; a < (int)matchA.size(); ++a)
+        {
+            slot[a] = -1;
+            if (matchA[a] != 0)
+            {
+                seat(a, matchA[a]);
+            }
+        }
+    }
+};
+
+// Capacitated Hopcroft-Karp. Students are layered by dist, courses by distC: the students sitting in a full
+// course h are one layer past it. freeDist is the layer of the first courses found with a free seat. As in bfs,
+// layers are numbered from 'base' and anything below it reads as unreached, so nothing is cleared between
+// phases, and the current arcs it / cur are reset for what is reached. 'queue' is scratch
+template <class Window>
+bool courseBfs(CourseMatching &m, vector<int> &dist, vector<int> &distC, int &freeDist, int &base, vector<int> &it, vector<int> &cur, vector<int> &queue, const Window &graph)
+{
+    if (base > INT_MAX - graph.numAgents - graph.numHouses - 2)
+    {
+        fill(dist.begin(), dist.end(), 0);
+        fill(distC.begin(), distC.end(), 0);
+        base = 1;
+    }
+    queue.clear();
+    for (int a = 1; a <= graph.numAgents; a++)
+    {
+        if (m.matchA[a] == 0)
+        {
+            dist[a] = base;
+            it[a] = 0;
+            queue.push_back(a);
+        }
+    }
+    freeDist = INT_MAX;
+    int top = base;
+
+    for (size_t i = 0; i < queue.size(); ++i)
+    {
+        int a = queue[i];
+        if (dist[a] >= freeDist)
+        {
+            continue;
+        }
+        for (int h : graph.prefs(a))
+        {
+            if (distC[h] >= base)
+            {
+                continue;
+            }
+            distC[h] = dist[a] + 1;
+            cur[h] = 0;
+            top = distC[h];
+            if (!m.full(h))
+            {
+                freeDist = distC[h];
+                continue;
+            }
+            for (int64_t s = m.start[h]; s < m.start[h] + m.load[h]; ++s)
+            {
+                int b = m.holder[s];
+                if (dist[b] < base)
+                {
+                    dist[b] = distC[h];
+                    it[b] = 0;
+                    queue.push_back(b);
+                }
+            }
+        }
+    }
+    if (freeDist != INT_MAX)
+    {
+        STAT_ADD(hkPhases, 1);
+        STAT_ADD(bfsLayers, freeDist - base);
+    }
+    base = top + 1;
+    return freeDist != INT_MAX;
+}
+
+// Search an augmenting path from the free student root with an explicit stack. it[a] is the current arc of
+// student a over its courses and cur[h] the current slot of course h, both kept for the whole phase. A dead
+// student gets dist 0, below every layer
+template <class Window>
+bool courseDfs(int root, CourseMatching &m, vector<int> &dist, vector<int> &distC, int freeDist, vector<int> &it, vector<int> &cur, vector<int> &path, const Window &graph)
+{
+    path.clear();
+    path.push_back(root);
+    while (!path.empty())
+    {
+        int a = path.back();
+        auto prefs = graph.prefs(a);
+        int next = -1; // 0 once a free seat is found, else the student to displace
+        for (; it[a] < (int)prefs.size(); it[a]++)
+        {
+            int h = prefs[it[a]];
+            STAT_ADD(dfsEdgeVisits, 1);
+            if (distC[h] != dist[a] + 1)
+            {
+                continue;
+            }
+            if (!m.full(h))
+            {
+                if (distC[h] == freeDist)
+                {
+                    next = 0;
+                    break;
+                }
+                continue;
+            }
+            for (; cur[h] < m.load[h]; cur[h]++)
+            {
+                int b = m.holder[m.start[h] + cur[h]];
+                if (dist[b] == distC[h])
+                {
+                    next = b;
+                    break;
+                }
+            }
+            if (next != -1)
+            {
+                break;
+            }
+        }
+
+        if (next == -1)
+        {
+            // Dead end for the rest of the phase, retreat and skip the student that led here
+            dist[a] = 0;
+            path.pop_back();
+            if (!path.empty())
+            {
+                int p = path.back();
+                cur[graph.prefs(p)[it[p]]]++;
+            }
+        }
+        else if (next == 0)
+        {
+            // The last student takes the free seat, every other one takes the slot of the student after it
+            STAT_ADD(augmentations, 1);
+            STAT_ADD(pathLengthTotal, path.size());
+            STAT_MAX(pathLengthMax, path.size());
+            m.seat(a, prefs[it[a]]);
+            for (int i = (int)path.size() - 2; i >= 0; --i)
+            {
+                int b = path[i], h = graph.prefs(b)[it[b]];
+                m.take(b, h, m.start[h] + cur[h]);
+            }
+            return true;
+        }
+        else
+        {
+            path.push_back(next);
+        }
+    }
+    return false;
+}
+
+// Run capacitated Hopcroft-Karp phases starting from the given matching, returns the number of augmentations.
+// The phases work in the scratch of m, so repeated calls allocate nothing
+template <class Window>
+int augmentCourseMatching(const Window &graph, CourseMatching &m)
+{
+    m.prepare(graph.numAgents, graph.numHouses);
+    int freeDist;
+    int augmented = 0;
+    while (courseBfs(m, m.dist, m.distC, freeDist, m.base, m.it, m.cur, m.queue, graph))
+    {
+        for (int a = 1; a <= graph.numAgents; a++)
+        {
+            if (m.matchA[a] == 0 && courseDfs(a, m, m.dist, m.distC, freeDist, m.it, m.cur, m.path, graph))
+            {
+                augmented++;
+            }
+        }
+    }
+    return augmented;
+}
+
+template <class Window>
+int courseHopcroftKarp(const Window &graph, const vector<int> &seats, CourseMatching &m)
+{
+    STAT_PHASE("courseHopcroftKarp");
+    m.reset(graph, seats);
+
+    // Greedy start, each student takes the first course in its list with a free seat
+    int warm = 0;
+    for (int a = 1; a <= graph.numAgents; ++a)
+    {
+        for (int h : graph.prefs(a))
+        {
+            if (!m.full(h))
+            {
+                m.seat(a, h);
+                warm++;
+                break;
+            }
+        }
+    }
+    return warm + augmentCourseMatching(graph, m);
+}
+
+// Courses as a market for top trading cycles. A course points to one of its students that is not settled,
+// found by a cursor over its slots, which stay as they were until the end
+struct CourseMarket
+{
+    CourseMatching &m;
+    vector<int> freeSeats;
+    vector<int64_t> pick;
+
+    explicit CourseMarket(CourseMatching &m) : m(m), freeSeats(m.load.size()), pick(m.load.size())
+    {
+        for (int h = 1; h < (int)m.load.size(); ++h)
+        {
+            freeSeats[h] = m.capacity(h) - m.load[h];
+            pick[h] = m.start[h];
+        }
+    }
+    bool hasRoom(int h) const { return freeSeats[h] > 0; }
+    int owner(int h, const TradingScratch &scratch)
+    {
+        int64_t end = m.start[h] + m.load[h];
+        while (pick[h] < end && scratch.settled(m.holder[pick[h]]))
+        {
+            pick[h]++;
+        }
+        return pick[h] == end ? 0 : m.holder[pick[h]];
+    }
+    void shift(int from, int to, int)
+    {
+        freeSeats[from]++;
+        freeSeats[to]--;
+    }
+    void finish(const vector<int> &) { m.rebuildSlots(); }
+};
+
+// Top trading cycles over courses, each preference entry and each slot is passed once
+template <class Window>
+void makeCoalitionFree(CourseMatching &m, const Window &graph)
+{
+    CourseMarket market(m);
+    topTradingCycles(m.matchA, graph, market);
+}
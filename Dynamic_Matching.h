@@ -0,0 +1,435 @@
+#pragma once
+#include "Graph.h"
+#include "Pareto.h"
+#include "Stats.h"
+
+using namespace std;
+
+// One batch of changes to a live allocation. Agents and houses keep their ids: a withdrawn agent is left with
+// an empty list and a withdrawn house is taken out of every list. Listing an agent past numAgents adds it, the
+// new ids must follow on from numAgents. Withdrawals win over a list given in the same batch
+struct MatchingUpdate
+{
+    vector<pair<int, vector<int>>> lists; // New preference list of an agent, most preferred first
+    vector<int> withdrawnAgents, withdrawnHouses;
+    int addedHouses = 0; // Houses numHouses + 1 .. numHouses + addedHouses, which the lists may already name
+    bool empty() const { return lists.empty() && withdrawnAgents.empty() && withdrawnHouses.empty() && addedHouses == 0; }
+};
+
+// A maximum, Pareto optimal matching kept up to date under updates, such as a maximum matching passed through
+// makeTradeInFree and makeCoalitionFree. The graph and the matching belong to the caller, the rest is the agents
+// ranking each house and scratch space reused by every update
+struct DynamicMatching
+{
+    Graph &graph;
+    vector<int> &matchA, &matchH;
+    int size;
+    HouseIndex<int> ranking;
+    vector<char> closed;     // Withdrawn houses
+    vector<char> offA, offH; // Not in the graph at this point of the update
+    vector<int> seenA, seenH, parent, queue, visited, touched;
+    int stamp = 0; // Marks of the current group of changes in seenA / seenH
+    TradingScratch trading;
+
+    DynamicMatching(Graph &graph, vector<int> &matchA, vector<int> &matchH)
+        : graph(graph), matchA(matchA), matchH(matchH), ranking(graph), closed(graph.numHouses + 1, 0)
+    {
+        size = graph.numAgents - count(matchA.begin() + 1, matchA.end(), 0);
+    }
+};
+
+// Alternating BFS from the free agent 'root' to a free house, flipping the path found. Every agent whose house
+// changes goes to 'touched'. A failed search leaves its houses marked: none of them leads to a free house, and
+// that lasts while the matching only grows, so later searches of the same group stop there
+bool augmentFromAgent(DynamicMatching &m, int root)
+{
+    m.queue.assign(1, root);
+    m.visited.clear();
+    for (size_t i = 0; i < m.queue.size(); ++i)
+    {
+        for (int h : m.graph.prefs(m.queue[i]))
+        {
+            if (m.offH[h] || m.seenH[h] == m.stamp)
+            {
+                continue;
+            }
+            m.seenH[h] = m.stamp;
+            m.visited.push_back(h);
+            m.parent[h] = m.queue[i];
+            if (m.matchH[h] == 0)
+            {
+                for (int g : m.visited)
+                {
+                    m.seenH[g] = 0;
+                }
+                while (h != 0)
+                {
+                    int a = m.parent[h], next = m.matchA[a];
+                    m.matchA[a] = h;
+                    m.matchH[h] = a;
+                    m.touched.push_back(a);
+                    h = next;
+                }
+                m.size++;
+                return true;
+            }
+            m.queue.push_back(m.matchH[h]); // Only reached through its own house, which is seen now
+        }
+    }
+    return false;
+}
+
+// Same from the free house 'root' towards a free agent, following the agents that rank each house
+bool augmentFromHouse(DynamicMatching &m, int root)
+{
+    m.queue.assign(1, root);
+    m.visited.clear();
+    for (size_t i = 0; i < m.queue.size(); ++i)
+    {
+        int h = m.queue[i];
+        for (int j = m.ranking.start[h]; j < m.ranking.start[h + 1]; ++j)
+        {
+            int b = m.ranking.agents[j];
+            if (m.offA[b] || m.seenA[b] == m.stamp)
+            {
+                continue;
+            }
+            m.seenA[b] = m.stamp;
+            m.visited.push_back(b);
+            m.parent[b] = h;
+            if (m.matchA[b] == 0)
+            {
+                for (int c : m.visited)
+                {
+                    m.seenA[c] = 0;
+                }
+                while (b != 0)
+                {
+                    int g = m.parent[b], next = m.matchH[g];
+                    m.matchH[g] = b;
+                    m.matchA[b] = g;
+                    m.touched.push_back(b);
+                    b = next;
+                }
+                m.size++;
+                return true;
+            }
+            m.queue.push_back(m.matchA[b]);
+        }
+    }
+    return false;
+}
+
+// Search from each of the free agents 'roots' in turn, for a group of changes after which every augmenting path
+// starts at one of them. Each success matches a root and no other path can appear, so one search per root is
+// enough. Nothing is searched once no house that anyone ranks is free
+void augmentFromAgents(DynamicMatching &m, const vector<int> &roots)
+{
+    int free = 0;
+    for (int h = 1; h <= m.graph.numHouses; ++h)
+    {
+        free += !m.offH[h] && m.matchH[h] == 0 && m.ranking.start[h] < m.ranking.start[h + 1];
+    }
+    m.stamp++;
+    for (int a : roots)
+    {
+        if (free > 0 && m.matchA[a] == 0 && augmentFromAgent(m, a))
+        {
+            free--;
+        }
+    }
+}
+
+// Same from free houses, 'roots' is left with the ones that stay free
+void augmentFromHouses(DynamicMatching &m, vector<int> &roots)
+{
+    int free = 0;
+    for (int a = 1; a <= m.graph.numAgents; ++a)
+    {
+        free += !m.offA[a] && m.matchA[a] == 0 && m.graph.degree(a) > 0;
+    }
+    m.stamp++;
+    int kept = 0;
+    for (int h : roots)
+    {
+        if (free > 0 && augmentFromHouse(m, h))
+        {
+            free--;
+        }
+        else
+        {
+            roots[kept++] = h;
+        }
+    }
+    roots.resize(kept);
+}
+
+// Houses as a market for top trading cycles started from a few agents. A house freed by a path is offered to the
+// agents that rank it above their own house, which join the seeds. Only agents the pass reached can have changed
+// houses, so matchH is repaired from them alone
+struct LocalHouseMarket : HouseMarket
+{
+    const DynamicMatching &m;
+    vector<int> &seeds;
+    LocalHouseMarket(const DynamicMatching &m, vector<int> &seeds) : HouseMarket{m.matchH}, m(m), seeds(seeds) {}
+    void shift(int from, int to, int a)
+    {
+        HouseMarket::shift(from, to, a);
+        for (int j = m.ranking.start[from]; j < m.ranking.start[from + 1]; ++j)
+        {
+            int b = m.ranking.agents[j];
+            if (m.matchA[b] != 0 && m.graph.rank(b, from) < m.graph.rank(b, m.matchA[b]))
+            {
+                seeds.push_back(b);
+            }
+        }
+    }
+    void finish(const vector<int> &matchA)
+    {
+        for (int a : m.trading.reached)
+        {
+            matchH[matchA[a]] = a;
+        }
+    }
+};
+
+// Apply one batch of changes and repair the matching, returns its new size.
+//
+// The changes come in four groups: agents leaving, houses leaving, houses arriving, agents arriving. After each
+// group every augmenting path has an end among the vertices it freed or added, so searching from each of them
+// once brings the matching back to maximum. The leaving groups run on the old graph with the leaving vertices
+// masked out, agents given a new list leave and arrive again. The lists are then rebuilt once, with the arriving
+// vertices masked until their group. Only agents whose house or list changed, and agents ranking a house freed on
+// the way above their own, can break Pareto optimality, so top trading cycles start from them alone. Throws
+// runtime_error, leaving everything as it was, when the batch names unknown ids
+int applyUpdate(DynamicMatching &m, const MatchingUpdate &update)
+{
+    STAT_PHASE("applyUpdate");
+    Graph &graph = m.graph;
+    int oldAgents = graph.numAgents, oldHouses = graph.numHouses;
+    if (update.addedHouses < 0 || update.addedHouses > INT_MAX - 1 - oldHouses)
+    {
+        throw runtime_error("cannot add " + to_string(update.addedHouses) + " houses");
+    }
+    int numHouses = oldHouses + update.addedHouses;
+    vector<int> added;
+    for (auto &[a, prefs] : update.lists)
+    {
+        if (a < 1 || a == INT_MAX)
+        {
+            throw runtime_error("agent " + to_string(a) + " out of range");
+        }
+        if (a > oldAgents)
+        {
+            added.push_back(a);
+        }
+        for (int h : prefs)
+        {
+            if (h < 1 || h > numHouses)
+            {
+                throw runtime_error("house " + to_string(h) + " not in [1, " + to_string(numHouses) + "]");
+            }
+        }
+    }
+    sort(added.begin(), added.end());
+    added.erase(unique(added.begin(), added.end()), added.end());
+    int numAgents = oldAgents + added.size();
+    if (!added.empty() && added.back() != numAgents)
+    {
+        throw runtime_error("new agents must be numbered from " + to_string(oldAgents + 1));
+    }
+    for (int a : update.withdrawnAgents)
+    {
+        if (a < 1 || a > numAgents)
+        {
+            throw runtime_error("agent " + to_string(a) + " not in [1, " + to_string(numAgents) + "]");
+        }
+    }
+    for (int h : update.withdrawnHouses)
+    {
+        if (h < 1 || h > numHouses)
+        {
+            throw runtime_error("house " + to_string(h) + " not in [1, " + to_string(numHouses) + "]");
+        }
+    }
+
+    // Last list given for each agent, none for withdrawn ones
+    vector<int> listOf(numAgents + 1, -1), listed;
+    for (int i = 0; i < (int)update.lists.size(); ++i)
+    {
+        int a = update.lists[i].first;
+        if (listOf[a] < 0)
+        {
+            listed.push_back(a);
+        }
+        listOf[a] = i;
+    }
+    vector<char> withdrawn(numAgents + 1, 0);
+    for (int a : update.withdrawnAgents)
+    {
+        withdrawn[a] = 1;
+        listOf[a] = -1;
+    }
+
+    // Departures on the old graph
+    m.offA.assign(oldAgents + 1, 0);
+    m.offH.assign(m.closed.begin(), m.closed.end());
+    m.seenA.resize(numAgents + 1, 0);
+    m.seenH.resize(numHouses + 1, 0);
+    m.parent.resize(max(numAgents, numHouses) + 1, 0);
+    m.touched.clear();
+    vector<int> freed, unmatched;
+    for (int a = 1; a <= oldAgents; ++a)
+    {
+        if (withdrawn[a] || listOf[a] >= 0)
+        {
+            m.offA[a] = 1;
+            int h = m.matchA[a];
+            if (h != 0)
+            {
+                m.matchA[a] = m.matchH[h] = 0;
+                m.size--;
+                freed.push_back(h);
+            }
+        }
+    }
+    augmentFromHouses(m, freed);
+    m.closed.resize(numHouses + 1, 0);
+    vector<int> closing;
+    for (int h : update.withdrawnHouses)
+    {
+        if (m.closed[h])
+        {
+            continue;
+        }
+        m.closed[h] = 1;
+        if (h > oldHouses)
+        {
+            continue;
+        }
+        closing.push_back(h);
+        m.offH[h] = 1;
+        int a = m.matchH[h];
+        if (a != 0)
+        {
+            m.matchA[a] = m.matchH[h] = 0;
+            m.size--;
+            unmatched.push_back(a);
+        }
+    }
+    augmentFromAgents(m, unmatched);
+
+    // Rebuild the lists without withdrawn houses. Lists that stay as they were are copied whole, and keep their
+    // entries in the rank and house indexes
+    vector<char> keep(numAgents + 1, 0);
+    for (int a = 1; a <= oldAgents; ++a)
+    {
+        keep[a] = !withdrawn[a] && listOf[a] < 0;
+    }
+    for (int h : closing)
+    {
+        for (int j = m.ranking.start[h]; j < m.ranking.start[h + 1]; ++j)
+        {
+            keep[m.ranking.agents[j]] = 0;
+        }
+    }
+    auto prefsOf = [&](int a)
+    {
+        if (listOf[a] >= 0)
+        {
+            const vector<int> &prefs = update.lists[listOf[a]].second;
+            return PrefList<int>{prefs.data(), prefs.data() + prefs.size()};
+        }
+        return a <= oldAgents && !withdrawn[a] ? graph.prefs(a) : PrefList<int>{nullptr, nullptr};
+    };
+    Graph next(numAgents, numHouses);
+    for (int a = 1; a <= numAgents; ++a)
+    {
+        int degree = keep[a] ? graph.degree(a) : 0;
+        if (!keep[a])
+        {
+            for (int h : prefsOf(a))
+            {
+                degree += !m.closed[h];
+            }
+        }
+        next.offset[a + 1] = next.offset[a] + degree;
+    }
+    next.house.resize(next.offset[numAgents + 1]);
+    for (int a = 1; a <= numAgents; ++a)
+    {
+        int *row = next.house.data() + next.offset[a];
+        if (keep[a])
+        {
+            copy(graph.prefs(a).begin(), graph.prefs(a).end(), row);
+            continue;
+        }
+        for (int h : prefsOf(a))
+        {
+            if (!m.closed[h])
+            {
+                *row++ = h;
+            }
+        }
+    }
+    next.ranks = move(graph.ranks);
+    next.ranks.rebuild(numAgents, numHouses, next.offset, next.house, keep);
+    graph = move(next);
+    m.ranking.update(graph, keep);
+    m.matchA.resize(numAgents + 1, 0);
+    m.matchH.resize(numHouses + 1, 0);
+
+    // Arrivals, agents stay masked while the houses arrive
+    m.offA.resize(numAgents + 1, 0);
+    vector<int> arriving;
+    for (int a : listed)
+    {
+        m.offA[a] = !withdrawn[a];
+    }
+    m.offH.resize(numHouses + 1, 1);
+    for (int h = oldHouses + 1; h <= numHouses; ++h)
+    {
+        if (!m.closed[h])
+        {
+            m.offH[h] = 0;
+            arriving.push_back(h);
+        }
+    }
+    augmentFromHouses(m, arriving);
+    freed.insert(freed.end(), arriving.begin(), arriving.end());
+    arriving.clear();
+    for (int a : listed)
+    {
+        if (!withdrawn[a])
+        {
+            m.offA[a] = 0;
+            arriving.push_back(a);
+        }
+    }
+    augmentFromAgents(m, arriving);
+
+    // Restore Pareto optimality around the changes
+    vector<int> seeds = m.touched;
+    for (int a : listed)
+    {
+        seeds.push_back(a);
+    }
+    for (int h : freed)
+    {
+        if (m.matchH[h] != 0 || m.closed[h])
+        {
+            continue;
+        }
+        for (int j = m.ranking.start[h]; j < m.ranking.start[h + 1]; ++j)
+        {
+            int b = m.ranking.agents[j];
+            if (m.matchA[b] != 0 && graph.rank(b, h) < graph.rank(b, m.matchA[b]))
+            {
+                seeds.push_back(b);
+            }
+        }
+    }
+    LocalHouseMarket market(m, seeds);
+    topTradingCycles(m.matchA, graph, market, seeds, m.trading);
+    return m.size;
+}
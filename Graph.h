@@ -0,0 +1,406 @@
+#pragma once
+#include <bits/stdc++.h>
+
+using namespace std;
+
+// Houses of one agent, most preferred first, stored as House ids
+template <class House>
+struct PrefList
+{
+    const House *first, *last;
+    const House *begin() const { return first; }
+    const House *end() const { return last; }
+    size_t size() const { return last - first; }
+    int operator[](size_t i) const { return first[i]; }
+};
+
+// Array that either owns its elements or views read-only memory kept alive by 'keep', such as a mapped binary
+// instance. Reading a view costs the same as reading an owned array, writing to one first copies it
+template <class T>
+class Buffer
+{
+public:
+    Buffer() = default;
+    Buffer(size_t n, const T &value) : owned(n, value), first(owned.data()), count(n) {}
+    Buffer(vector<T> &&v) : owned(move(v)), first(owned.data()), count(owned.size()) {}
+    Buffer(const T *data, size_t n, shared_ptr<const void> keep) : first(data), count(n), keep(move(keep)) {}
+    Buffer(const Buffer &other) : owned(other.owned), first(other.keep ? other.first : owned.data()), count(other.count), keep(other.keep) {}
+    Buffer(Buffer &&other) noexcept { swap(other); }
+    Buffer &operator=(Buffer other) noexcept
+    {
+        swap(other);
+        return *this;
+    }
+    void swap(Buffer &other) noexcept
+    {
+        owned.swap(other.owned); // Swaps the storage, so 'first' stays right on both sides
+        std::swap(first, other.first);
+        std::swap(count, other.count);
+        keep.swap(other.keep);
+    }
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    const T *data() const { return first; }
+    const T *begin() const { return first; }
+    const T *end() const { return first + count; }
+    const T &operator[](size_t i) const { return first[i]; }
+    const T &back() const { return first[count - 1]; }
+    T *data()
+    {
+        own();
+        return owned.data();
+    }
+    T *begin() { return data(); }
+    T *end() { return data() + count; }
+    T &operator[](size_t i) { return data()[i]; }
+    void resize(size_t n, const T &value = T())
+    {
+        own();
+        owned.resize(n, value);
+        first = owned.data();
+        count = n;
+    }
+    bool isView() const { return keep != nullptr; }
+
+private:
+    vector<T> owned;
+    const T *first = nullptr;
+    size_t count = 0;
+    shared_ptr<const void> keep; // Owner of the viewed memory, null for an owned array
+
+    void own()
+    {
+        if (keep)
+        {
+            owned.assign(first, first + count);
+            first = owned.data();
+            keep.reset();
+        }
+    }
+};
+
+// Fresh generation for preference lists just completed, unique in the process, so what was built from one set of
+// lists is never taken for another, even one refilled at the same address
+uint64_t nextListsGeneration()
+{
+    static atomic<uint64_t> counter{0};
+    return ++counter;
+}
+
+// rank(a, h) is the position of house h in the list of agent a, -1 when a does not rank h. Small instances use a
+// dense numAgents x numHouses table, larger ones keep every list sorted by house and search it. Offset is the
+// position type of the graph the index belongs to
+template <class Offset>
+class RankIndex
+{
+public:
+    // Whether build picks the dense table for this size
+    static bool wantsDense(int numAgents, int numHouses, size_t edges)
+    {
+        return (size_t)(numAgents + 1) * (numHouses + 1) <= max<size_t>(denseCells, 4 * edges);
+    }
+
+    template <class House>
+    void build(int numAgents, int numHouses, const Buffer<Offset> &offset, const Buffer<House> &house)
+    {
+        this->numHouses = numHouses;
+        lists = nextListsGeneration();
+        size_t cells = (size_t)(numAgents + 1) * (numHouses + 1);
+        dense = wantsDense(numAgents, numHouses, house.size());
+        if (dense)
+        {
+            table.assign(cells, -1);
+            for (int a = 1; a <= numAgents; ++a)
+            {
+                for (Offset i = offset[a + 1] - 1; i >= offset[a]; --i) // Backwards so a repeated house keeps its best rank
+                {
+                    table[(size_t)a * (numHouses + 1) + house[i]] = int(i - offset[a]);
+                }
+            }
+            return;
+        }
+        start = offset;
+        sorted.resize(house.size());
+        for (int a = 1; a <= numAgents; ++a)
+        {
+            for (Offset i = offset[a]; i < offset[a + 1]; ++i)
+            {
+                sorted[i] = {int(house[i]), int(i - offset[a])};
+            }
+            sort(sorted.begin() + offset[a], sorted.begin() + offset[a + 1]);
+        }
+    }
+
+    // Same as build after some lists changed. Agents with keep[a] set have the same list as before, now found at
+    // offset[a], and reuse their sorted pairs, so the sparse form is mostly copied
+    template <class House>
+    void rebuild(int numAgents, int numHouses, const Buffer<Offset> &offset, const Buffer<House> &house, const vector<char> &keep)
+    {
+        if (dense || wantsDense(numAgents, numHouses, house.size()))
+        {
+            build(numAgents, numHouses, offset, house);
+            return;
+        }
+        this->numHouses = numHouses;
+        lists = nextListsGeneration();
+        const Buffer<pair<int, int>> &old = sorted; // Read only, a viewed index is not copied first
+        vector<pair<int, int>> next(house.size());
+        for (int a = 1; a <= numAgents; ++a)
+        {
+            if (a + 1 < (int)start.size() && keep[a])
+            {
+                copy(old.begin() + start[a], old.begin() + start[a + 1], next.begin() + offset[a]);
+                continue;
+            }
+            for (Offset i = offset[a]; i < offset[a + 1]; ++i)
+            {
+                next[i] = {int(house[i]), int(i - offset[a])};
+            }
+            sort(next.begin() + offset[a], next.begin() + offset[a + 1]);
+        }
+        sorted = move(next);
+        start = offset;
+    }
+
+    int rank(int a, int h) const
+    {
+        if (dense)
+        {
+            return table[(size_t)a * (numHouses + 1) + h];
+        }
+        auto first = sorted.begin() + start[a], last = sorted.begin() + start[a + 1];
+        auto it = lower_bound(first, last, pair<int, int>{h, INT_MIN});
+        return it != last && it->first == h ? it->second : -1;
+    }
+
+    // Take the sparse form as it is, with pairs laid out like the house array that offset describes
+    void adopt(int numHouses, const Buffer<Offset> &offset, Buffer<pair<int, int>> pairs)
+    {
+        this->numHouses = numHouses;
+        lists = nextListsGeneration();
+        dense = false;
+        table.clear();
+        start = offset;
+        sorted = move(pairs);
+    }
+    bool isDense() const { return dense; }
+    uint64_t generation() const { return lists; }
+    const Buffer<pair<int, int>> &sortedPairs() const { return sorted; }
+
+private:
+    static constexpr size_t denseCells = 1 << 22;
+    int numHouses = 0;
+    uint64_t lists = 0;            // Generation of the lists indexed, taken anew by build, rebuild and adopt
+    bool dense = true;
+    vector<int> table;             // Dense: rank of house h for agent a at a * (numHouses + 1) + h
+    Buffer<Offset> start;          // Sparse: copy of the graph offsets
+    Buffer<pair<int, int>> sorted; // Sparse: (house, rank) pairs of every list, sorted by house, laid out like house
+};
+
+// Graph structure in compressed sparse row form: the houses agent a finds acceptable are
+// house[offset[a]] .. house[offset[a + 1] - 1], all lists stored back to back in one array. House ids are stored
+// as House, uint16_t keeps the lists of instances with fewer than 65536 houses at half the size, and positions in
+// the house array as Offset, int64_t once the edge count passes INT_MAX. Ids are handed out as int either way
+template <class House, class Offset>
+struct BasicGraph
+{
+    using HouseType = House;
+    using OffsetType = Offset;
+    int numAgents, numHouses;
+    Buffer<Offset> offset; // offset[a] is where the list of agent a starts, offset[numAgents + 1] is the edge count
+    Buffer<House> house;   // Concatenated preference lists, both may view a mapped binary instance
+    RankIndex<Offset> ranks; // Filled by indexRanks once the lists are complete
+    BasicGraph() : BasicGraph(0, 0) {}
+    BasicGraph(int a, int h) : numAgents(a), numHouses(h), offset(a + 2, 0) {} // +1 for one-based indexing
+    // Every agent ranks exactly numPref houses, as in the input format
+    BasicGraph(int a, int h, int numPref) : BasicGraph(a, h) { reshape(a, h, numPref); }
+    // Same layout in place, reusing the buffers of the previous graph
+    void reshape(int a, int h, int numPref)
+    {
+        numAgents = a;
+        numHouses = h;
+        offset.resize(a + 2);
+        offset[0] = 0;
+        for (int i = 1; i <= a + 1; ++i)
+        {
+            offset[i] = (Offset)(i - 1) * numPref;
+        }
+        house.resize((size_t)a * numPref);
+    }
+    PrefList<House> prefs(int a) const { return {house.data() + offset[a], house.data() + offset[a + 1]}; }
+    int degree(int a) const { return int(offset[a + 1] - offset[a]); }
+    // Length of the longest list, past it no rank adds an edge. Lists may hold a house twice, so it can exceed
+    // numHouses
+    int longestList() const
+    {
+        int longest = 0;
+        for (int a = 1; a <= numAgents; ++a)
+        {
+            longest = max(longest, degree(a));
+        }
+        return longest;
+    }
+    void indexRanks() { ranks.build(numAgents, numHouses, offset, house); }
+    int rank(int a, int h) const { return ranks.rank(a, h); }
+    // Changes whenever the lists are indexed again, 0 before they are indexed at all
+    uint64_t generation() const { return ranks.generation(); }
+};
+
+// Plain int ids and offsets, the graph updates and generated instances work on
+using Graph = BasicGraph<int, int>;
+
+// Graph of the narrowest widths that hold an instance, picked by the loader from its size: 16-bit house ids below
+// 65536 houses, 64-bit offsets past INT_MAX edges. The solvers run on whichever it holds through visit
+using AnyGraph = variant<BasicGraph<uint16_t, int>, BasicGraph<int, int>, BasicGraph<uint16_t, int64_t>, BasicGraph<int, int64_t>>;
+
+// Whether G can store an instance of this size
+template <class G>
+bool fitsWidths(int64_t numHouses, int64_t edges)
+{
+    return numHouses <= numeric_limits<typename G::HouseType>::max() && edges <= numeric_limits<typename G::OffsetType>::max();
+}
+
+// Make graph hold the widths for an instance of this size, keeping its buffers when it already does
+void chooseWidths(AnyGraph &graph, int64_t numHouses, int64_t edges)
+{
+    size_t index = (edges > INT_MAX ? 2 : 0) + (numHouses > UINT16_MAX ? 1 : 0);
+    if (graph.index() == index)
+    {
+        return;
+    }
+    switch (index)
+    {
+    case 0:
+        graph.emplace<0>();
+        break;
+    case 1:
+        graph.emplace<1>();
+        break;
+    case 2:
+        graph.emplace<2>();
+        break;
+    default:
+        graph.emplace<3>();
+    }
+}
+
+// Read-only view of the preference ranks [lo, hi) of every agent, used instead of copying restricted graphs.
+// The algorithms take either a window or a graph, which is the same as its widest window
+template <class G>
+struct RankWindow
+{
+    using HouseType = typename G::HouseType;
+    using OffsetType = typename G::OffsetType;
+    const G *graph;
+    int lo, hi;
+    int numAgents, numHouses;
+    RankWindow(const G &g, int lo, int hi) : graph(&g), lo(lo), hi(hi), numAgents(g.numAgents), numHouses(g.numHouses) {}
+    RankWindow(const G &g) : RankWindow(g, 0, INT_MAX) {} // The whole preference lists
+    // Houses ranked lo..hi-1 by agent a
+    PrefList<HouseType> prefs(int a) const
+    {
+        const HouseType *row = graph->house.data() + graph->offset[a];
+        int n = graph->degree(a);
+        return {row + min(lo, n), row + min(hi, n)};
+    }
+    // Rank of house h within the window of agent a, -1 when h falls outside it
+    int rank(int a, int h) const
+    {
+        int r = graph->rank(a, h);
+        return r >= lo && r < hi ? r - lo : -1;
+    }
+};
+
+// The whole graph behind a window and the ranks [lo, hi) the window keeps, a graph being its own widest window
+template <class House, class Offset>
+const BasicGraph<House, Offset> &wholeGraph(const BasicGraph<House, Offset> &graph) { return graph; }
+template <class G>
+const G &wholeGraph(const RankWindow<G> &window) { return *window.graph; }
+template <class House, class Offset>
+pair<int, int> rankBounds(const BasicGraph<House, Offset> &) { return {0, INT_MAX}; }
+template <class G>
+pair<int, int> rankBounds(const RankWindow<G> &window) { return {window.lo, window.hi}; }
+
+// Agents ranking each house inside a window: agents[start[h]] .. agents[start[h + 1] - 1], with positions of
+// the same type as the graph offsets
+template <class Offset>
+struct HouseIndex
+{
+    vector<Offset> start;
+    vector<int> agents;
+    template <class Window>
+    explicit HouseIndex(const Window &graph) : start(graph.numHouses + 2, 0)
+    {
+        for (int a = 1; a <= graph.numAgents; ++a)
+        {
+            for (int h : graph.prefs(a))
+            {
+                start[h + 1]++;
+            }
+        }
+        partial_sum(start.begin(), start.end(), start.begin());
+        agents.resize(start.back());
+        vector<Offset> fill(start.begin(), start.end() - 1);
+        for (int a = 1; a <= graph.numAgents; ++a)
+        {
+            for (int h : graph.prefs(a))
+            {
+                agents[fill[h]++] = a;
+            }
+        }
+    }
+
+    // Bring the index in line with graph after some lists changed. Agents with keep[a] set have the same list as
+    // before and keep their entries, the others are added again from their new lists
+    template <class Window>
+    void update(const Window &graph, const vector<char> &keep)
+    {
+        vector<Offset> next(graph.numHouses + 2, 0);
+        for (int h = 1; h + 1 < (int)start.size(); ++h)
+        {
+            for (Offset j = start[h]; j < start[h + 1]; ++j)
+            {
+                next[h + 1] += keep[agents[j]];
+            }
+        }
+        for (int a = 1; a <= graph.numAgents; ++a)
+        {
+            if (!keep[a])
+            {
+                for (int h : graph.prefs(a))
+                {
+                    next[h + 1]++;
+                }
+            }
+        }
+        partial_sum(next.begin(), next.end(), next.begin());
+        vector<int> nextAgents(next.back());
+        vector<Offset> fill(next.begin(), next.end() - 1);
+        for (int h = 1; h + 1 < (int)start.size(); ++h)
+        {
+            for (Offset j = start[h]; j < start[h + 1]; ++j)
+            {
+                if (keep[agents[j]])
+                {
+                    nextAgents[fill[h]++] = agents[j];
+                }
+            }
+        }
+        for (int a = 1; a <= graph.numAgents; ++a)
+        {
+            if (!keep[a])
+            {
+                for (int h : graph.prefs(a))
+                {
+                    nextAgents[fill[h]++] = a;
+                }
+            }
+        }
+        start = move(next);
+        agents = move(nextAgents);
+    }
+};
+
+template <class Window>
+HouseIndex(const Window &) -> HouseIndex<typename Window::OffsetType>;
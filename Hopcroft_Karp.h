@@ -0,0 +1,483 @@
+#pragma once
+#include "Graph.h"
+#include "Solver_Workspace.h"
+#include "Stats.h"
+#include "Warm_Start.h"
+
+using namespace std;
+
+// Hopcroft-Karp layering. Layers are numbered from 'base', which moves past the deepest one after every phase, so
+// any dist below base reads as unreached and nothing is cleared between phases. dist[0] stands for the free
+// houses. The current arc it[a] is reset for the agents reached, the only ones dfs enters. 'queue' is scratch
+template <class Window>
+bool bfs(vector<int> &matchA, vector<int> &matchH, vector<int> &dist, int &base, vector<int> &it, vector<int> &queue, const Window &graph)
+{
+    if (base > INT_MAX - graph.numAgents - 2)
+    {
+        fill(dist.begin(), dist.end(), 0);
+        base = 1;
+    }
+    queue.clear();
+    for (int a = 1; a <= graph.numAgents; a++)
+    {
+        if (matchA[a] == 0) // Unmatched agents have matchA[a] = 0 in one-based indexing
+        {
+            dist[a] = base;
+            it[a] = 0;
+            queue.push_back(a);
+        }
+    }
+    dist[0] = 0;
+    int freeLayer = INT_MAX, top = base;
+
+    for (size_t i = 0; i < queue.size(); ++i)
+    {
+        int a = queue[i];
+        if (dist[a] < freeLayer)
+        {
+            for (int h : graph.prefs(a))
+            {
+                int b = matchH[h];
+                if (dist[b] < base)
+                {
+                    dist[b] = dist[a] + 1;
+                    top = dist[b];
+                    if (b == 0)
+                    {
+                        freeLayer = dist[0];
+                        continue;
+                    }
+                    it[b] = 0;
+                    queue.push_back(b);
+                }
+            }
+        }
+    }
+    if (freeLayer != INT_MAX)
+    {
+        STAT_ADD(hkPhases, 1);
+        STAT_ADD(bfsLayers, freeLayer - base);
+    }
+    base = top + 1;
+    return freeLayer != INT_MAX;
+}
+
+// Blocks the threads of a parallel BFS until all of them reached the end of the level
+class LevelBarrier
+{
+public:
+    explicit LevelBarrier(int count) : count(count) {}
+    void wait()
+    {
+        unique_lock<mutex> guard(lock);
+        long long generation = this->generation;
+        if (++waiting == count)
+        {
+            waiting = 0;
+            this->generation++;
+            done.notify_all();
+            return;
+        }
+        done.wait(guard, [&]
+                  { return generation != this->generation; });
+    }
+
+private:
+    mutex lock;
+    condition_variable done;
+    int count, waiting = 0;
+    long long generation = 0;
+};
+
+// Same layering as bfs, one level at a time on 'threads' threads. A top-down level hands out chunks of the
+// frontier, agents of the next level are claimed with a compare-and-swap on dist. Once the frontier holds a
+// large share of the unvisited agents, a bottom-up level lets every unvisited matched agent look for a frontier
+// agent among those ranking its house inside the window in the index of 'par' instead, which needs no claims.
+// Levels too small to be worth sharing are expanded by thread 0 alone while the others wait. Levels are numbered
+// from 'base' and the current arcs reset for the agents reached, as in bfs, so a phase only writes what it
+// reaches. The threads come from the pool of 'par'
+template <class Window>
+bool parallelBfs(vector<int> &matchA, vector<int> &matchH, vector<int> &dist, int &base, vector<int> &it, const Window &graph, ParallelScratch &par, int threads)
+{
+    if (base > INT_MAX - graph.numAgents - 2)
+    {
+        fill(dist.begin(), dist.end(), 0);
+        base = 1;
+    }
+    auto [lo, hi] = rankBounds(graph);
+    // Whether an agent ranking house h inside the window is at the given level, the entries of h being sorted by
+    // rank the scan stops at the end of the window
+    auto rankedAtLevel = [&, lo = lo, hi = hi](int h, int level)
+    {
+        for (int64_t j = par.start[h]; j < par.start[h + 1] && par.entries[j].first < hi; ++j)
+        {
+            if (par.entries[j].first >= lo && __atomic_load_n(&dist[par.entries[j].second], __ATOMIC_RELAXED) == level)
+            {
+                return true;
+            }
+        }
+        return false;
+    };
+    const int chunk = 1024, serialLimit = 4 * chunk;
+    vector<int> frontier;
+    vector<vector<int>> next(threads); // Next level found by each thread
+    atomic<int> cursor{0};
+    atomic<bool> freeSeen{false}; // Set during a level, moved into found by thread 0 so that every thread stops together
+    bool found = false, bottomUp = false;
+    int level = base, unvisited = 0;
+    LevelBarrier barrier(threads);
+
+    // Thread 0 alone joins the next level between two barriers and picks the direction of the next step
+    auto join = [&]()
+    {
+        found = found || freeSeen;
+        frontier.clear();
+        for (vector<int> &part : next)
+        {
+            frontier.insert(frontier.end(), part.begin(), part.end());
+            part.clear();
+        }
+        unvisited -= frontier.size();
+        bottomUp = (long long)frontier.size() * 14 > unvisited;
+        cursor = 0;
+    };
+    auto advance = [&]()
+    {
+        join();
+        while (!frontier.empty() && !found && !bottomUp && (int)frontier.size() < serialLimit)
+        {
+            for (int a : frontier)
+            {
+                for (int h : graph.prefs(a))
+                {
+                    int b = matchH[h];
+                    if (b == 0)
+                    {
+                        found = true;
+                    }
+                    else if (dist[b] < base)
+                    {
+                        dist[b] = level + 1;
+                        it[b] = 0;
+                        next[0].push_back(b);
+                    }
+                }
+            }
+            level++;
+            join();
+        }
+    };
+
+    auto worker = [&](int t)
+    {
+        int first = (long long)graph.numAgents * t / threads + 1, last = (long long)graph.numAgents * (t + 1) / threads + 1;
+        for (int a = first; a < last; ++a)
+        {
+            if (matchA[a] == 0)
+            {
+                dist[a] = base;
+                it[a] = 0;
+                next[t].push_back(a);
+            }
+        }
+        barrier.wait();
+        if (t == 0)
+        {
+            unvisited = graph.numAgents;
+            advance();
+        }
+        barrier.wait();
+
+        while (!frontier.empty() && !found)
+        {
+            bool free = false;
+            if (!bottomUp)
+            {
+                for (int begin = cursor.fetch_add(chunk); begin < (int)frontier.size(); begin = cursor.fetch_add(chunk))
+                {
+                    for (int i = begin; i < min<int>(begin + chunk, frontier.size()); ++i)
+                    {
+                        for (int h : graph.prefs(frontier[i]))
+                        {
+                            int b = matchH[h];
+                            if (b == 0)
+                            {
+                                free = true;
+                                continue;
+                            }
+                            int seen = __atomic_load_n(&dist[b], __ATOMIC_RELAXED);
+                            if (seen < base && __atomic_compare_exchange_n(&dist[b], &seen, level + 1, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+                            {
+                                it[b] = 0;
+                                next[t].push_back(b);
+                            }
+                        }
+                    }
+                }
+            }
+            else
+            {
+                for (int b = first; b < last; ++b)
+                {
+                    if (matchA[b] == 0 || dist[b] >= base)
+                    {
+                        continue;
+                    }
+                    if (rankedAtLevel(matchA[b], level))
+                    {
+                        __atomic_store_n(&dist[b], level + 1, __ATOMIC_RELAXED);
+                        it[b] = 0;
+                        next[t].push_back(b);
+                    }
+                }
+                // A free house ranked by a frontier agent ends the search after this level
+                for (int h = (long long)graph.numHouses * t / threads + 1; h < (long long)graph.numHouses * (t + 1) / threads + 1 && !free; ++h)
+                {
+                    free = matchH[h] == 0 && rankedAtLevel(h, level);
+                }
+            }
+            if (free)
+            {
+                freeSeen = true;
+            }
+            barrier.wait();
+            if (t == 0)
+            {
+                level++;
+                advance();
+            }
+            barrier.wait();
+        }
+    };
+
+    par.pool.run(threads, worker);
+
+    // The free houses found sit one level past the last frontier that was expanded, which is also the deepest
+    // level written
+    dist[0] = found ? level : 0;
+    if (found)
+    {
+        STAT_ADD(hkPhases, 1);
+        STAT_ADD(bfsLayers, level - base);
+    }
+    base = level + 1;
+    return found;
+}
+
+// Search an augmenting path from the free agent root along the BFS layers, using an explicit stack.
+// it[a] is the current arc of agent a: the edges before it were already proven dead in this phase. A dead agent
+// gets dist 0, which no layer of either bfs follows
+template <class Window>
+bool dfs(int root, vector<int> &matchA, vector<int> &matchH, vector<int> &dist, vector<int> &it, vector<int> &path, const Window &graph)
+{
+    path.clear();
+    path.push_back(root);
+    while (!path.empty())
+    {
+        int a = path.back();
+        auto prefs = graph.prefs(a);
+        int next = -1;
+        for (; it[a] < (int)prefs.size(); it[a]++)
+        {
+            STAT_ADD(dfsEdgeVisits, 1);
+            if (dist[matchH[prefs[it[a]]]] == dist[a] + 1)
+            {
+                next = matchH[prefs[it[a]]];
+                break;
+            }
+        }
+
+        if (next == -1)
+        {
+            // Dead end for the rest of the phase, retreat and skip the edge that led here
+            dist[a] = 0;
+            path.pop_back();
+            if (!path.empty())
+            {
+                it[path.back()]++;
+            }
+        }
+        else if (next == 0)
+        {
+            // Reached a free house, every agent on the path takes the house of its current arc
+            STAT_ADD(augmentations, 1);
+            STAT_ADD(pathLengthTotal, path.size());
+            STAT_MAX(pathLengthMax, path.size());
+            for (int b : path)
+            {
+                int h = graph.prefs(b)[it[b]];
+                matchH[h] = b;
+                matchA[b] = h;
+            }
+            return true;
+        }
+        else
+        {
+            path.push_back(next);
+        }
+    }
+    return false;
+}
+
+// Claim a vertex for the current phase, false when another search already holds it
+bool claim(int &stamp, int phase)
+{
+    int seen = __atomic_load_n(&stamp, __ATOMIC_ACQUIRE);
+    return seen != phase && __atomic_compare_exchange_n(&stamp, &seen, phase, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+
+// Search vertex-disjoint augmenting paths along the BFS layers from every free agent on 'threads' threads.
+// Every agent entered and every free house taken is claimed first in claimA / claimH, so each vertex belongs to
+// one search for the whole phase and paths never cross. A search that lost a claim may have missed a path and
+// its root goes to 'retry' for the serial pass, one that failed without losing any claim proves its root dead.
+// The current arcs in it were reset by parallelBfs. The threads come from 'pool'. Returns the number of
+// augmentations
+template <class Window>
+int parallelAugment(vector<int> &matchA, vector<int> &matchH, const vector<int> &dist, vector<int> &it, vector<int> &claimA, vector<int> &claimH, int phase, const Window &graph, WorkerPool &pool, int threads, vector<int> &retry)
+{
+    vector<int> roots;
+    for (int a = 1; a <= graph.numAgents; a++)
+    {
+        if (matchA[a] == 0)
+        {
+            roots.push_back(a);
+        }
+    }
+    atomic<int> cursor{0}, augmented{0};
+    mutex lock;
+
+    auto worker = [&](int)
+    {
+        vector<int> path, lost;
+        for (int r = cursor++; r < (int)roots.size(); r = cursor++)
+        {
+            int root = roots[r];
+            bool conflict = false;
+            claim(claimA[root], phase);
+            path.assign(1, root);
+            while (!path.empty())
+            {
+                int a = path.back();
+                auto prefs = graph.prefs(a);
+                int next = -1;
+                for (; it[a] < (int)prefs.size(); it[a]++)
+                {
+                    int h = prefs[it[a]], b = __atomic_load_n(&matchH[h], __ATOMIC_ACQUIRE);
+                    STAT_ADD(dfsEdgeVisits, 1);
+                    if (dist[b] != dist[a] + 1)
+                    {
+                        continue;
+                    }
+                    if (b == 0 ? claim(claimH[h], phase) : claim(claimA[b], phase))
+                    {
+                        next = b;
+                        break;
+                    }
+                    conflict = true;
+                }
+
+                if (next == -1)
+                {
+                    path.pop_back();
+                    if (!path.empty())
+                    {
+                        it[path.back()]++;
+                    }
+                }
+                else if (next == 0)
+                {
+                    STAT_ADD(augmentations, 1);
+                    STAT_ADD(pathLengthTotal, path.size());
+                    STAT_MAX(pathLengthMax, path.size());
+                    for (int b : path)
+                    {
+                        int h = graph.prefs(b)[it[b]];
+                        __atomic_store_n(&matchH[h], b, __ATOMIC_RELEASE);
+                        matchA[b] = h;
+                    }
+                    augmented++;
+                    break;
+                }
+                else
+                {
+                    path.push_back(next);
+                }
+            }
+            if (path.empty() && conflict)
+            {
+                lost.push_back(root);
+            }
+        }
+        lock_guard<mutex> guard(lock);
+        retry.insert(retry.end(), lost.begin(), lost.end());
+    };
+
+    pool.run(threads, worker);
+    return augmented;
+}
+
+// Run Hopcroft-Karp phases starting from the given matching, returns the number of augmentations.
+// With several threads both the layering and the path searches of each phase run in parallel, the roots whose
+// parallel search ran into another one are searched again serially before the next phase. Both take their
+// buffers from ws, parallel phases also their threads and the house index of the whole graph, which every window
+// of it shares, so repeated calls allocate nothing
+template <class Window>
+int augmentMatching(const Window &graph, vector<int> &matchA, vector<int> &matchH, int threads, SolverWorkspace &ws)
+{
+    int augmented = 0;
+    if (threads > 1)
+    {
+        ParallelScratch &par = ws.parallel;
+        par.prepare(wholeGraph(graph));
+        vector<int> &dist = par.dist, &it = par.it;
+        while (parallelBfs(matchA, matchH, dist, par.base, it, graph, par, threads))
+        {
+            par.retry.clear();
+            augmented += parallelAugment(matchA, matchH, dist, it, par.claimA, par.claimH, ++par.phase, graph, par.pool, threads, par.retry);
+            if (!par.retry.empty())
+            {
+                // Arcs skipped over a lost claim were not proven dead, the serial pass looks at every arc again
+                fill(it.begin(), it.end(), 0);
+            }
+            for (int a : par.retry)
+            {
+                if (dfs(a, matchA, matchH, dist, it, par.path, graph))
+                {
+                    augmented++;
+                }
+            }
+        }
+        return augmented;
+    }
+
+    ws.prepare(graph.numAgents, graph.numHouses);
+    while (bfs(matchA, matchH, ws.dist, ws.base, ws.it, ws.queue, graph))
+    {
+        for (int a = 1; a <= graph.numAgents; a++)
+        {
+            if (matchA[a] == 0 && dfs(a, matchA, matchH, ws.dist, ws.it, ws.path, graph))
+            {
+                augmented++;
+            }
+        }
+    }
+    return augmented;
+}
+
+template <class Window>
+int augmentMatching(const Window &graph, vector<int> &matchA, vector<int> &matchH, int threads = 1)
+{
+    SolverWorkspace ws;
+    return augmentMatching(graph, matchA, matchH, threads, ws);
+}
+
+template <class Window>
+int hopcroftKarp(const Window &graph, vector<int> &matchA, vector<int> &matchH, int threads = 1)
+{
+    STAT_PHASE("hopcroftKarp");
+    matchA.assign(graph.numAgents + 1, 0); // One-based, 0 means unmatched
+    matchH.assign(graph.numHouses + 1, 0); // One-based, 0 means unmatched
+
+    int warm = warmStart(graph, matchA, matchH);
+    return warm + augmentMatching(graph, matchA, matchH, threads);
+}
@@ -0,0 +1,320 @@
+#pragma once
+#include <charconv>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "Binary_Instance.h"
+
+using namespace std;
+
+// Reads a whole instance at once: a regular file is memory-mapped, a pipe is read in large blocks.
+// Integers are parsed in place with from_chars, errors report the line and column of the bad token
+class InputReader
+{
+public:
+    explicit InputReader(int fd)
+    {
+        struct stat st;
+        if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0)
+        {
+            void *p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED)
+            {
+                madvise(p, st.st_size, MADV_SEQUENTIAL);
+                mapped = p;
+                data = (const char *)p;
+                size = st.st_size;
+                return;
+            }
+        }
+        const size_t block = 1 << 20;
+        ssize_t n;
+        do
+        {
+            buffer.resize(size + block);
+            n = read(fd, buffer.data() + size, block);
+            size += max<ssize_t>(n, 0);
+        } while (n > 0);
+        data = buffer.data();
+    }
+    ~InputReader()
+    {
+        if (mapped)
+        {
+            munmap(mapped, size);
+        }
+    }
+    InputReader(const InputReader &) = delete;
+    InputReader &operator=(const InputReader &) = delete;
+
+    // Next whitespace separated integer, 'what' names it in the error message
+    int nextInt(const char *what)
+    {
+        while (pos < size && isspace((unsigned char)data[pos]))
+        {
+            pos++;
+        }
+        tokenStart = pos;
+        if (pos == size)
+        {
+            fail(string("unexpected end of input, expected ") + what);
+        }
+        int value;
+        auto [end, ec] = from_chars(data + pos, data + size, value);
+        if (ec == errc::result_out_of_range)
+        {
+            fail(string(what) + " out of range");
+        }
+        if (ec != errc() || (end != data + size && !isspace((unsigned char)*end)))
+        {
+            fail(string("expected ") + what);
+        }
+        pos = end - data;
+        return value;
+    }
+
+    // The whole input, for binary instances used in place
+    const char *bytes() const { return data; }
+    size_t length() const { return size; }
+
+    // Access pattern of a binary instance viewed for the whole run, instead of one sequential scan
+    void expectRandomAccess()
+    {
+        if (mapped)
+        {
+            madvise(mapped, size, MADV_NORMAL);
+        }
+    }
+
+    // Bytes not read yet
+    size_t remaining() const { return size - pos; }
+
+    // True once only whitespace is left, for inputs holding several instances
+    bool atEnd()
+    {
+        while (pos < size && isspace((unsigned char)data[pos]))
+        {
+            pos++;
+        }
+        return pos == size;
+    }
+
+    // Next integer, which must lie in [lo, hi]
+    int nextInt(const char *what, int lo, int hi)
+    {
+        int value = nextInt(what);
+        if (value < lo || value > hi)
+        {
+            fail(string(what) + " " + to_string(value) + " not in [" + to_string(lo) + ", " + to_string(hi) + "]");
+        }
+        return value;
+    }
+
+    // Throw with the position of the last token read
+    [[noreturn]] void fail(const string &message) const
+    {
+        int line = 1, column = 1;
+        for (size_t i = 0; i < tokenStart; ++i)
+        {
+            if (data[i] == '\n')
+            {
+                line++;
+                column = 1;
+            }
+            else
+            {
+                column++;
+            }
+        }
+        throw runtime_error("line " + to_string(line) + ", column " + to_string(column) + ": " + message);
+    }
+
+private:
+    const char *data = nullptr;
+    size_t size = 0, pos = 0, tokenStart = 0;
+    void *mapped = nullptr;
+    vector<char> buffer;
+};
+
+// Counts at the head of a text instance
+struct InstanceSize
+{
+    int numAgents, numHouses, numPref;
+    int64_t edges() const { return (int64_t)numAgents * numPref; }
+};
+
+// Read "numAgents numHouses numPref" and the seat line when seats is given
+InstanceSize readInstanceSize(InputReader &in, vector<int> *seats)
+{
+    InstanceSize size;
+    size.numAgents = in.nextInt("number of agents", 0, INT_MAX - 1);
+    size.numHouses = in.nextInt("number of houses", 0, INT_MAX - 1);
+    size.numPref = in.nextInt("number of preferences", 0, INT_MAX);
+    // Every house id and seat count takes two bytes at least, counts beyond that cannot be real and would only
+    // allocate. Agents with empty lists and houses on no list take no bytes, a few of them are let through
+    if ((uint64_t)size.edges() > in.remaining() / 2)
+    {
+        in.fail("preference lists longer than the input");
+    }
+    if (size.numAgents > (1 << 16) && (uint64_t)size.numAgents > in.remaining() / 2)
+    {
+        in.fail("more agents than the input can list");
+    }
+    if (size.numHouses > (1 << 16) && (uint64_t)size.numHouses > in.remaining() / 2)
+    {
+        in.fail("more houses than the input can list");
+    }
+    if (seats)
+    {
+        if ((uint64_t)size.numHouses > in.remaining() / 2)
+        {
+            in.fail("seat line longer than the input");
+        }
+        seats->assign(size.numHouses + 1, 0);
+        for (int i = 1; i <= size.numHouses; ++i)
+        {
+            (*seats)[i] = in.nextInt("seat count", 0, INT_MAX);
+        }
+    }
+    return size;
+}
+
+// Read every preference row straight into the CSR arrays of the graph, then index the ranks
+template <class G>
+void readPreferences(InputReader &in, const InstanceSize &size, G &graph)
+{
+    graph.reshape(size.numAgents, size.numHouses, size.numPref);
+    for (auto &h : graph.house)
+    {
+        h = in.nextInt("house id", 1, size.numHouses);
+    }
+    graph.indexRanks();
+}
+
+// Read "numAgents numHouses numPref", the seat line when seats is given, then the preference rows into graph,
+// which must be wide enough for the instance. The buffers of graph are reused
+template <class G>
+void readInstance(InputReader &in, G &graph, int &numPref, vector<int> *seats = nullptr)
+{
+    InstanceSize size = readInstanceSize(in, seats);
+    if (!fitsWidths<G>(size.numHouses, size.edges()))
+    {
+        in.fail("instance too large for " + to_string(8 * sizeof(typename G::HouseType)) + "-bit house ids and " +
+                to_string(8 * sizeof(typename G::OffsetType)) + "-bit offsets");
+    }
+    numPref = size.numPref;
+    readPreferences(in, size, graph);
+}
+
+// Same, with graph switched to the narrowest widths that hold the instance
+void readInstance(InputReader &in, AnyGraph &graph, int &numPref, vector<int> *seats = nullptr)
+{
+    InstanceSize size = readInstanceSize(in, seats);
+    chooseWidths(graph, size.numHouses, size.edges());
+    numPref = size.numPref;
+    visit([&](auto &g)
+          { readPreferences(in, size, g); },
+          graph);
+}
+
+// Copy graph 'from' into 'to', whose widths may differ and must hold it. A graph of the same type is moved,
+// views and all
+template <class From, class To>
+void convertGraph(From &from, To &to)
+{
+    if constexpr (is_same_v<From, To>)
+    {
+        to = move(from);
+    }
+    else
+    {
+        if (!fitsWidths<To>(from.numHouses, from.house.size()))
+        {
+            throw runtime_error("instance too large for the id widths of this program");
+        }
+        to.numAgents = from.numAgents;
+        to.numHouses = from.numHouses;
+        to.offset = Buffer<typename To::OffsetType>(vector<typename To::OffsetType>(from.offset.begin(), from.offset.end()));
+        to.house = Buffer<typename To::HouseType>(vector<typename To::HouseType>(from.house.begin(), from.house.end()));
+        to.indexRanks();
+    }
+}
+
+// Run a read, reporting a failed allocation as a runtime_error, so an instance the header checks let through
+// but the machine cannot hold is rejected like any other invalid input
+template <class Read>
+void guardAllocation(Read read)
+{
+    try
+    {
+        read();
+    }
+    catch (const bad_alloc &)
+    {
+        throw runtime_error("instance too large");
+    }
+    catch (const length_error &)
+    {
+        throw runtime_error("instance too large");
+    }
+}
+
+// Read a text or binary instance from fd into graph. A binary one is viewed where it lies, so the graph keeps the
+// mapping of a regular file, or the buffer a pipe was read into, for as long as it uses it. One stored with other
+// id widths than G is copied instead
+template <class G>
+void loadInstance(int fd, G &graph, int &numPref, vector<int> *seats = nullptr)
+{
+    auto read = [&]()
+    {
+        auto in = make_shared<InputReader>(fd);
+        if (isBinaryInstance(in->bytes(), in->length()))
+        {
+            in->expectRandomAccess();
+            AnyGraph stored;
+            viewBinaryInstance(in->bytes(), in->length(), in, stored, numPref, seats);
+            visit([&](auto &g)
+                  { convertGraph(g, graph); },
+                  stored);
+            return;
+        }
+        readInstance(*in, graph, numPref, seats);
+    };
+    guardAllocation(read);
+}
+
+// Same, with graph switched to the widths the instance needs, or was stored with
+void loadInstance(int fd, AnyGraph &graph, int &numPref, vector<int> *seats = nullptr)
+{
+    auto read = [&]()
+    {
+        auto in = make_shared<InputReader>(fd);
+        if (isBinaryInstance(in->bytes(), in->length()))
+        {
+            in->expectRandomAccess();
+            viewBinaryInstance(in->bytes(), in->length(), in, graph, numPref, seats);
+            return;
+        }
+        readInstance(*in, graph, numPref, seats);
+    };
+    guardAllocation(read);
+}
+
+// Read the text or binary instance on standard input, reporting malformed input and exiting. G is Graph or
+// AnyGraph, which takes the narrowest widths for the instance
+template <class G = Graph>
+G readInstanceFromStdin(int &numPref, vector<int> *seats = nullptr)
+{
+    G graph;
+    try
+    {
+        loadInstance(STDIN_FILENO, graph, numPref, seats);
+        return graph;
+    }
+    catch (const runtime_error &e)
+    {
+        cerr << "Invalid input: " << e.what() << endl;
+        exit(1);
+    }
+}
@@ -0,0 +1,40 @@
+#include <bits/stdc++.h>
+
+#include "Binary_Instance.h"
+#include "Input.h"
+
+using namespace std;
+
+// Convert a text instance to the binary format of Binary_Instance.h, which every solver maps and uses in place.
+// The ids are stored with the narrowest widths that hold the instance
+// Usage: Instance_Converter [--courses] < instance.txt > instance.bin
+// --courses reads and stores the seat line of Course_Allocation instances
+int main(int argc, char **argv)
+{
+    bool courses = false;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (string(argv[i]) == "--courses")
+        {
+            courses = true;
+        }
+    }
+    if (isatty(STDOUT_FILENO))
+    {
+        cerr << "Refusing to write a binary instance to a terminal" << endl;
+        return 1;
+    }
+
+    int numPref;
+    vector<int> seats;
+    AnyGraph graph = readInstanceFromStdin<AnyGraph>(numPref, courses ? &seats : nullptr);
+    bool written = visit([&](const auto &graph)
+                         { return writeBinaryInstance(stdout, graph, numPref, courses ? &seats : nullptr); },
+                         graph);
+    if (!written)
+    {
+        cerr << "Cannot write the binary instance" << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include "Matching_Engine.h"
+
+using namespace std;
+
+// Sweep k upwards, widening the window to the top 'k' preferences and augmenting the previous matching,
+// until the matching reaches the maximal matching size. The matching is built in ws.matchA / ws.matchH and every
+// probe reuses the buffers of ws. Returns that k, 0 when no window reaches the size
+template <class G>
+int leastDissatisfaction(const G &graph, int maxMatchingSize, SolverWorkspace &ws, MatchingEngine engine = MatchingEngine::HopcroftKarp, int threads = 1)
+{
+    STAT_PHASE("leastDissatisfaction");
+    ws.prepare(graph.numAgents, graph.numHouses);
+    ws.matchA.assign(graph.numAgents + 1, 0);
+    ws.matchH.assign(graph.numHouses + 1, 0);
+    int matchingSize = 0;
+    int longest = graph.longestList();
+    for (int k = 1; k <= longest; ++k)
+    {
+        // The matching of the previous step stays valid, only augment from it
+        matchingSize += augmentMatching(RankWindow(graph, 0, k), ws.matchA, ws.matchH, engine, threads, ws);
+        STAT_ADD(windowProbes, 1);
+
+        if (matchingSize == maxMatchingSize)
+        {
+            return k;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include "Hopcroft_Karp.h"
+#include "Pothen_Fan.h"
+#include "Push_Relabel.h"
+
+using namespace std;
+
+// Maximum matching backends. Each one grows the matching it is given, so all of them can be warm-started,
+// and leaves the same matchA / matchH layout. The matchings they reach have the same size but may differ
+enum class MatchingEngine
+{
+    HopcroftKarp,
+    PushRelabel,
+    PothenFan
+};
+
+bool parseMatchingEngine(const string &name, MatchingEngine &engine)
+{
+    if (name == "hopcroft-karp")
+        engine = MatchingEngine::HopcroftKarp;
+    else if (name == "push-relabel")
+        engine = MatchingEngine::PushRelabel;
+    else if (name == "pothen-fan")
+        engine = MatchingEngine::PothenFan;
+    else
+        return false;
+    return true;
+}
+
+// Grow the given matching to a maximum one with the chosen engine, returns the number of agents added.
+// Only Hopcroft-Karp makes use of several threads, and of the buffers of ws
+template <class Window>
+int augmentMatching(const Window &graph, vector<int> &matchA, vector<int> &matchH, MatchingEngine engine, int threads, SolverWorkspace &ws)
+{
+    switch (engine)
+    {
+    case MatchingEngine::PushRelabel:
+        return pushRelabel(graph, matchA, matchH);
+    case MatchingEngine::PothenFan:
+        return pothenFan(graph, matchA, matchH);
+    default:
+        return augmentMatching(graph, matchA, matchH, threads, ws);
+    }
+}
+
+template <class Window>
+int augmentMatching(const Window &graph, vector<int> &matchA, vector<int> &matchH, MatchingEngine engine, int threads = 1)
+{
+    SolverWorkspace ws;
+    return augmentMatching(graph, matchA, matchH, engine, threads, ws);
+}
+
+template <class Window>
+int maximumMatching(const Window &graph, vector<int> &matchA, vector<int> &matchH, MatchingEngine engine, int threads = 1)
+{
+    if (engine == MatchingEngine::HopcroftKarp)
+    {
+        return hopcroftKarp(graph, matchA, matchH, threads); // Keeps its own phase timer
+    }
+    STAT_PHASE("maximumMatching");
+    matchA.assign(graph.numAgents + 1, 0);
+    matchH.assign(graph.numHouses + 1, 0);
+    int warm = warmStart(graph, matchA, matchH);
+    return warm + augmentMatching(graph, matchA, matchH, engine);
+}
@@ -0,0 +1,121 @@
+#pragma once
+#include "Matching_Engine.h"
+#include "Pareto.h"
+
+using namespace std;
+
+// Best window found so far, shared by the threads of minSpread. The matching is copied into buffers reserved
+// up front, the prober goes on sliding from its own
+struct SpreadResult
+{
+    mutex lock;
+    atomic<int> spread{INT_MAX};  // Read without the lock to prune windows that cannot win
+    atomic<int> deadFrom{INT_MAX}; // No window starting at or after this rank reaches the maximal matching size
+    int lo = -1;
+    vector<int> &matchA, &matchH;
+    SpreadResult(vector<int> &matchA, vector<int> &matchH) : matchA(matchA), matchH(matchH) {}
+};
+
+// Slide a rank window [lo, hi) over the start ranks loBegin..loEnd-1: widening it adds a rank and augments the
+// matching, moving lo forward drops a rank and repairs only the agents that were matched through it.
+// Windows longer than the best spread found so far by any thread are never probed. The sliding matching and the
+// scratch of every probe come from ws
+template <class G>
+void slideWindow(const G &graph, int maxMatchingSize, int numPref, int loBegin, int loEnd, SpreadResult &best, MatchingEngine engine, SolverWorkspace &ws)
+{
+    vector<int> &matchA = ws.matchA, &matchH = ws.matchH;
+    matchA.assign(graph.numAgents + 1, 0);
+    matchH.assign(graph.numHouses + 1, 0);
+    int matchingSize = 0;
+    int hi = loBegin;
+    for (int lo = loBegin; lo < loEnd && lo < best.deadFrom; lo++)
+    {
+        if (lo > loBegin)
+        {
+            // Unassign the agents holding their (lo-1)-th preference, the rest of the matching stays in the window
+            for (int a = 1; a <= graph.numAgents; ++a)
+            {
+                if (matchA[a] != 0 && graph.prefs(a)[lo - 1] == matchA[a])
+                {
+                    matchH[matchA[a]] = 0;
+                    matchA[a] = 0;
+                    matchingSize--;
+                }
+            }
+            matchingSize += augmentMatching(RankWindow(graph, lo, hi), matchA, matchH, engine, 1, ws);
+            STAT_ADD(windowProbes, 1);
+        }
+
+        // Widen the window until the matching is maximal again
+        while (hi <= lo || (matchingSize < maxMatchingSize && hi < numPref && hi - lo < best.spread))
+        {
+            hi++;
+            matchingSize += augmentMatching(RankWindow(graph, lo, hi), matchA, matchH, engine, 1, ws);
+            STAT_ADD(windowProbes, 1);
+        }
+        if (matchingSize < maxMatchingSize)
+        {
+            if (hi == numPref)
+            {
+                // Even the widest window starting at lo fails, later starts cannot do better
+                int dead = best.deadFrom;
+                while (lo < dead && !best.deadFrom.compare_exchange_weak(dead, lo))
+                    ;
+                break;
+            }
+            continue; // Cannot beat the best spread from this start
+        }
+
+        // Ties go to the lowest start rank, so the result does not depend on the thread count
+        if (hi - lo <= best.spread)
+        {
+            lock_guard<mutex> guard(best.lock);
+            if (hi - lo < best.spread || (hi - lo == best.spread && lo < best.lo))
+            {
+                best.spread = hi - lo;
+                best.lo = lo;
+                best.matchA.assign(matchA.begin(), matchA.end());
+                best.matchH.assign(matchH.begin(), matchH.end());
+            }
+        }
+    }
+}
+
+// Search the start ranks in chunks spread over 'threads' workers of ws.parallel.pool, each with its own matching.
+// The calling thread works in ws, the others in ws.helpers, kept for the next call. The best matching is left in
+// ws.bestA / ws.bestH, trade-in-free and coalition-free. Returns its spread, -1 when no window reaches the
+// maximal matching size, and then leaves an empty matching there
+template <class G>
+int minSpread(const G &graph, int maxMatchingSize, int numPref, int threads, SolverWorkspace &ws, MatchingEngine engine = MatchingEngine::HopcroftKarp)
+{
+    STAT_PHASE("minSpread");
+    ws.prepare(graph.numAgents, graph.numHouses);
+    while ((int)ws.helpers.size() < threads - 1)
+    {
+        ws.helpers.push_back(make_unique<SolverWorkspace>());
+    }
+    SpreadResult best(ws.bestA, ws.bestH);
+    int numChunks = threads == 1 ? 1 : min(numPref, 4 * threads);
+    atomic<int> nextChunk{0};
+    auto worker = [&](int t)
+    {
+        SolverWorkspace &own = t == 0 ? ws : *ws.helpers[t - 1];
+        own.prepare(graph.numAgents, graph.numHouses);
+        for (int c = nextChunk++; c < numChunks; c = nextChunk++)
+        {
+            slideWindow(graph, maxMatchingSize, numPref, (long long)numPref * c / numChunks, (long long)numPref * (c + 1) / numChunks, best, engine, own);
+        }
+    };
+    ws.parallel.pool.run(threads, ref(worker)); // Held by reference, the job is not copied to the heap
+
+    if (best.lo == -1)
+    {
+        ws.bestA.assign(graph.numAgents + 1, 0);
+        ws.bestH.assign(graph.numHouses + 1, 0);
+        return -1;
+    }
+    RankWindow finalRestrictedGraph(graph, best.lo, best.lo + best.spread);
+    makeTradeInFree(ws.bestA, ws.bestH, finalRestrictedGraph, ws.tradeIn);
+    makeCoalitionFree(ws.bestA, ws.bestH, finalRestrictedGraph);
+    return best.spread;
+}
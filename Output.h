@@ -0,0 +1,164 @@
+#pragma once
+#include <charconv>
+
+#include "Graph.h"
+
+using namespace std;
+
+// Text: "Agent a is assigned to House h" lines, Tsv: "agent\thouse\trank" lines with one-based ranks,
+// Binary: matchA[1..numAgents] as raw native int32, 0 for unmatched agents
+enum class OutputFormat
+{
+    Text,
+    Tsv,
+    Binary
+};
+
+bool parseOutputFormat(const string &name, OutputFormat &format)
+{
+    if (name == "text")
+        format = OutputFormat::Text;
+    else if (name == "tsv")
+        format = OutputFormat::Tsv;
+    else if (name == "binary")
+        format = OutputFormat::Binary;
+    else
+        return false;
+    return true;
+}
+
+// Buffers the whole report and writes it to stdout in large blocks. Without a file the report and the notes
+// are kept in memory until taken, for reports assembled in another order than they are made
+class OutputWriter
+{
+public:
+    explicit OutputWriter(OutputFormat format, FILE *out = stdout) : format(format), out(out) { buffer.reserve(bufferSize); }
+    ~OutputWriter() { flush(); }
+    OutputWriter(const OutputWriter &) = delete;
+    OutputWriter &operator=(const OutputWriter &) = delete;
+
+    // A summary line such as "Minimum Spread: 3", sent to stderr when stdout carries a machine-readable format
+    void note(const string &line)
+    {
+        if (format != OutputFormat::Text)
+        {
+            if (!out)
+            {
+                notes += line;
+                notes += '\n';
+                return;
+            }
+            flush();
+            fprintf(stderr, "%s\n", line.c_str());
+            return;
+        }
+        buffer += line;
+        buffer += '\n';
+        flushIfFull();
+    }
+
+    // Raw text, written as is
+    void text(const string &s)
+    {
+        buffer += s;
+        flushIfFull();
+    }
+
+    void number(long long x)
+    {
+        char tmp[24];
+        buffer.append(tmp, to_chars(tmp, tmp + sizeof(tmp), x).ptr);
+    }
+
+    // The assignment of every matched agent. houseName maps house ids to the ids printed, when given
+    template <class G>
+    void assignments(const vector<int> &matchA, const G &graph, const char *agentLabel = "Agent", const char *houseLabel = "House", const vector<int> &houseName = {})
+    {
+        auto name = [&](int h)
+        { return houseName.empty() || h == 0 ? h : houseName[h]; };
+        if (format == OutputFormat::Binary)
+        {
+            flush();
+            vector<int32_t> row(graph.numAgents);
+            for (int a = 1; a <= graph.numAgents; ++a)
+            {
+                row[a - 1] = name(matchA[a]);
+            }
+            if (!out)
+            {
+                buffer.append((const char *)row.data(), row.size() * sizeof(int32_t));
+                return;
+            }
+            fwrite(row.data(), sizeof(int32_t), row.size(), out);
+            return;
+        }
+        for (int a = 1; a <= graph.numAgents; ++a)
+        {
+            if (matchA[a] == 0)
+            {
+                continue;
+            }
+            if (format == OutputFormat::Text)
+            {
+                buffer += agentLabel;
+                buffer += ' ';
+                number(a);
+                buffer += " is assigned to ";
+                buffer += houseLabel;
+                buffer += ' ';
+                number(name(matchA[a]));
+            }
+            else
+            {
+                number(a);
+                buffer += '\t';
+                number(name(matchA[a]));
+                buffer += '\t';
+                number(graph.rank(a, matchA[a]) + 1);
+            }
+            buffer += '\n';
+            flushIfFull();
+        }
+    }
+
+    void flush()
+    {
+        if (!out)
+        {
+            return;
+        }
+        fwrite(buffer.data(), 1, buffer.size(), out);
+        buffer.clear();
+        fflush(out);
+    }
+
+    // Everything written so far without a file, leaving the writer empty
+    string takeReport()
+    {
+        string report = move(buffer);
+        buffer.clear();
+        return report;
+    }
+    string takeNotes()
+    {
+        string taken = move(notes);
+        notes.clear();
+        return taken;
+    }
+
+    const OutputFormat format;
+
+private:
+    static const size_t bufferSize = 1 << 16;
+    FILE *out;
+    string buffer, notes;
+
+    void flushIfFull()
+    {
+        if (out && buffer.size() >= bufferSize)
+        {
+            fwrite(buffer.data(), 1, buffer.size(), out);
+            buffer.clear();
+        }
+    }
+};
@@ -6,258 +6,79 @@
 #include <list>
 #include <bits/stdc++.h>
 
+#include "Batch.h"
+#include "Input.h"
+#include "Matching_Engine.h"
+#include "Output.h"
+#include "Pareto.h"
+#include "Solver_Options.h"
+
 using namespace std;
 
-// Graph structure
-struct Graph
+// Matching and trade-in buffers kept from one instance to the next in batch mode
+struct Workspace
 {
-    int numAgents, numHouses;
-    vector<vector<int>> adj;                                        // adj[a] contains houses that agent a finds acceptable
-    Graph(int a, int h) : numAgents(a), numHouses(h), adj(a + 1) {} // One-based indexing
+    vector<int> matchA, matchH;
+    TradeInScratch tradeIn;
 };
 
-// Phase 1: Hopcroft-Karp Algorithm to find maximal matching
-bool bfs(vector<int> &matchA, vector<int> &matchH, vector<int> &dist, const Graph &graph)
-{
-    queue<int> Q;
-    for (int a = 1; a <= graph.numAgents; a++)
-    {
-        if (matchA[a] == 0)
-        { // Use 0 to represent unmatched
-            dist[a] = 0;
-            Q.push(a);
-        }
-        else
-        {
-            dist[a] = INT_MAX;
-        }
-    }
-    dist[0] = INT_MAX; // Use 0 for the NIL node
-
-    while (!Q.empty())
-    {
-        int a = Q.front();
-        Q.pop();
-        if (dist[a] < dist[0])
-        {
-            for (int h : graph.adj[a])
-            {
-                if (dist[matchH[h]] == INT_MAX)
-                {
-                    dist[matchH[h]] = dist[a] + 1;
-                    Q.push(matchH[h]);
-                }
-            }
-        }
-    }
-    return dist[0] != INT_MAX;
-}
-
-bool dfs(int a, vector<int> &matchA, vector<int> &matchH, vector<int> &dist, const Graph &graph)
-{
-    if (a != 0)
-    {
-        for (int h : graph.adj[a])
-        {
-            if (dist[matchH[h]] == dist[a] + 1)
-            {
-                if (dfs(matchH[h], matchA, matchH, dist, graph))
-                {
-                    matchH[h] = a;
-                    matchA[a] = h;
-                    return true;
-                }
-            }
-        }
-        dist[a] = INT_MAX;
-        return false;
-    }
-    return true;
-}
-
-int hopcroftKarp(const Graph &graph, vector<int> &matchA, vector<int> &matchH)
+template <class G>
+void solve(const G &graph, Workspace &ws, OutputWriter &out, MatchingEngine engine, int threads)
 {
-    matchA.assign(graph.numAgents + 1, 0); // One-based indexing
-    matchH.assign(graph.numHouses + 1, 0); // One-based indexing
-    vector<int> dist(graph.numAgents + 1);
+    bool showPhases = out.format == OutputFormat::Text; // Machine-readable formats only carry the final matching
+    vector<int> &matchA = ws.matchA, &matchH = ws.matchH;
 
-    int matchingSize = 0;
-    while (bfs(matchA, matchH, dist, graph))
-    {
-        for (int a = 1; a <= graph.numAgents; a++)
-        {
-            if (matchA[a] == 0 && dfs(a, matchA, matchH, dist, graph))
-            {
-                matchingSize++;
-            }
-        }
-    }
-    return matchingSize;
-}
-
-// Phase 2: Make the matching trade-in-free
-void makeTradeInFree(vector<int> &matchA, vector<int> &matchH, const Graph &graph)
-{
-    vector<list<pair<int, int>>> prefLists(graph.numHouses + 1);
-    vector<int> curRank(graph.numAgents + 1, -1);
-    queue<int> unmatchedHouses;
-
-    for (int a = 1; a <= graph.numAgents; ++a)
+    // Phase 1: Find maximal matching
+    maximumMatching(graph, matchA, matchH, engine, threads);
+    if (showPhases)
     {
-        if (matchA[a] != 0)
-        {
-            int h = matchA[a];
-            curRank[a] = find(graph.adj[a].begin(), graph.adj[a].end(), h) - graph.adj[a].begin();
-            prefLists[h].push_back({a, curRank[a]});
-        }
+        out.assignments(matchA, graph);
     }
 
-    for (int h = 1; h <= graph.numHouses; ++h)
+    // Phase 2: Make the matching trade-in-free
+    makeTradeInFree(matchA, matchH, graph, ws.tradeIn);
+    if (showPhases)
     {
-        if (matchH[h] == 0 && !prefLists[h].empty())
-        {
-            unmatchedHouses.push(h);
-        }
+        out.assignments(matchA, graph);
     }
 
-    while (!unmatchedHouses.empty())
-    {
-        int h = unmatchedHouses.front();
-        unmatchedHouses.pop();
-
-        while (!prefLists[h].empty())
-        {
-            auto [a, rank] = prefLists[h].front();
-            prefLists[h].pop_front();
-            if (rank < curRank[a])
-            {
-                int oldH = matchA[a];
-                matchA[a] = h;
-                matchH[h] = a;
-                if (!prefLists[oldH].empty())
-                {
-                    unmatchedHouses.push(oldH);
-                }
-                break;
-            }
-        }
-    }
-}
-
-// Phase 3: Remove coalitions using Top Trading Cycles Method
-void makeCoalitionFree(vector<int>& matchA, vector<int>& matchH, const Graph& graph) {
-    vector<int> ptr(graph.numAgents + 1, 0); // Tracks the next preference for each agent
-    bool improved;
-
-    do {
-        improved = false;
-        vector<bool> visitedAgent(graph.numAgents + 1, false);
-        vector<bool> visitedHouse(graph.numHouses + 1, false);
-
-        for (int a = 1; a <= graph.numAgents; ++a) {
-            // Skip if agent is unmatched or already visited
-            if (matchA[a] == 0 || visitedAgent[a]) continue;
-
-            vector<int> cycleAgents, cycleHouses;
-            int currentAgent = a;
-
-            // Detect a cycle among matched agents
-            while (true) {
-                if (visitedAgent[currentAgent]) break;
-                visitedAgent[currentAgent] = true;
-
-                // Find the next preferred house not owned by the current agent
-                int nextHouse = -1;
-                while (ptr[currentAgent] > graph.adj[currentAgent].size()) {
-                    nextHouse = graph.adj[currentAgent][ptr[currentAgent]++];
-                    if (nextHouse != matchA[currentAgent] && !visitedHouse[nextHouse]) {
-                        break;
-                    }
-                }
-                if (nextHouse == -1) break;
-
-                cycleAgents.push_back(currentAgent);
-                cycleHouses.push_back(nextHouse);
-                visitedHouse[nextHouse] = true;
-
-                // Move to the owner of the next house (if matched)
-                currentAgent = matchH[nextHouse];
-                if (currentAgent == 0) break; // Skip if house is unassigned
-            }
+    // // Phase 3: Make the matching coalition-free
+    makeCoalitionFree(matchA, matchH, graph);
 
-            // Execute the cycle if it's valid (size > 1)
-            if (cycleAgents.size() > 1) {
-                improved = true;
-                // Unassign all agents in the cycle from their current houses
-                for (int agent : cycleAgents) {
-                    if (matchA[agent] != 0) {
-                        matchH[matchA[agent]] = 0;
-                    }
-                }
-                // Assign new houses in the cycle
-                for (size_t i = 0; i < cycleAgents.size(); ++i) {
-                    int agent = cycleAgents[i];
-                    int house = cycleHouses[i];
-                    matchA[agent] = house;
-                    matchH[house] = agent;
-                }
-            }
-        }
-    } while (improved); // Repeat until no more improvements
+    // Output the final Pareto optimal matching
+    out.note("Pareto Optimal Matching:");
+    out.assignments(matchA, graph);
 }
 
-// Main function to execute the algorithm
-int main()
+// Usage: Pareto-Optimality [--threads N] [--format text|tsv|binary] [--engine hopcroft-karp|push-relabel|pothen-fan]
+//                          [--batch | --batch-dir DIR] < instance, N = 0 uses every core
+// --batch solves every instance of stdin, --batch-dir every file of DIR, N instances at a time
+int main(int argc, char **argv)
 {
-    int numAgents, numHouses, numPref;
-    cin >> numAgents >> numHouses >> numPref;
-    Graph graph(numAgents, numHouses);
-    for (int i=0; i<numAgents; i++)
+    SolverOptions options;
+    if (!parseSolverOptions(argc, argv, "Pareto-Optimality [--threads N] [--format text|tsv|binary] [--engine name] [--batch | --batch-dir DIR] < instance", options))
     {
-        for (int j=0; j<numPref; j++)
-        {
-            int h;
-            cin>>h;
-            graph.adj[i+1].push_back(h);
-            graph.adj[h].push_back(i+1);
-        }
+        return 1;
     }
-    
 
-    vector<int> matchA, matchH;
-
-    // Phase 1: Find maximal matching
-    int maxMatchingSize = hopcroftKarp(graph, matchA, matchH);
-    for (int a = 1; a <= numAgents; ++a)
-    {
-        if (matchA[a] != 0)
-        {
-            cout << "Agent " << a << " is assigned to House " << matchA[a] << "\n";
-        }
-    }
-
-    // Phase 2: Make the matching trade-in-free
-    makeTradeInFree(matchA, matchH, graph);
-    for (int a = 1; a <= numAgents; ++a)
+    if (options.batch)
     {
-        if (matchA[a] != 0)
-        {
-            cout << "Agent " << a << " is assigned to House " << matchA[a] << "\n";
-        }
+        int status = runBatch<Workspace>(options.batchDir, false, options.format, options.threads, [&](BatchInstance &instance, Workspace &ws, OutputWriter &out)
+                                         { visit([&](const auto &graph)
+                                                 { solve(graph, ws, out, options.engine, 1); },
+                                                 instance.graph); });
+        reportStats(); // Only with -DMATCHING_STATS
+        return status;
     }
 
-    // // Phase 3: Make the matching coalition-free
-    makeCoalitionFree(matchA, matchH, graph);
-
-    // Output the final Pareto optimal matching
-    cout << "Pareto Optimal Matching:\n";
-    for (int a = 1; a <= numAgents; ++a)
-    {
-        if (matchA[a] != 0)
-        {
-            cout << "Agent " << a << " is assigned to House " << matchA[a] << "\n";
-        }
-    }
+    int numPref;
+    AnyGraph graph = readInstanceFromStdin<AnyGraph>(numPref);
+    Workspace ws;
+    OutputWriter out(options.format);
+    visit([&](const auto &graph)
+          { solve(graph, ws, out, options.engine, options.threads); },
+          graph);
 
+    reportStats(); // Only with -DMATCHING_STATS
     return 0;
 }
@@ -0,0 +1,265 @@
+#pragma once
+#include "Graph.h"
+#include "Stats.h"
+
+using namespace std;
+
+// Buffers of makeTradeInFree, kept from one call to the next. The agents requesting house h are
+// agents[start[h]] .. agents[start[h + 1] - 1] in agent order, next[h] is the first one not looked at yet
+struct TradeInScratch
+{
+    vector<int64_t> start, next;
+    vector<int> agents, curRank, queue;
+};
+
+// Make the matching trade-in-free: no matched agent may prefer a free house to its own. Each free house keeps
+// the agents that rank it above their current house, a house freed by a move is queued in turn. Agents only move
+// up, so every requester entry is looked at once
+template <class Window>
+void makeTradeInFree(vector<int> &matchA, vector<int> &matchH, const Window &graph, TradeInScratch &scratch)
+{
+    STAT_PHASE("makeTradeInFree");
+    vector<int64_t> &start = scratch.start, &next = scratch.next;
+    vector<int> &requesters = scratch.agents, &curRank = scratch.curRank, &unmatchedHouses = scratch.queue;
+    curRank.assign(graph.numAgents + 1, -1);
+    start.assign(graph.numHouses + 2, 0);
+    for (int a = 1; a <= graph.numAgents; ++a)
+    {
+        if (matchA[a] != 0)
+        {
+            curRank[a] = graph.rank(a, matchA[a]);
+            auto prefs = graph.prefs(a);
+            for (int r = 0; r < curRank[a]; ++r)
+            {
+                start[prefs[r] + 1]++;
+            }
+        }
+    }
+    partial_sum(start.begin(), start.end(), start.begin());
+    requesters.resize(start.back());
+    next.assign(start.begin(), start.end() - 1);
+    for (int a = 1; a <= graph.numAgents; ++a)
+    {
+        auto prefs = graph.prefs(a);
+        for (int r = 0; r < curRank[a]; ++r)
+        {
+            requesters[next[prefs[r]]++] = a;
+        }
+    }
+    next.assign(start.begin(), start.end() - 1);
+
+    unmatchedHouses.clear();
+    for (int h = 1; h <= graph.numHouses; ++h)
+    {
+        if (matchH[h] == 0 && next[h] < start[h + 1])
+        {
+            unmatchedHouses.push_back(h);
+        }
+    }
+
+    for (size_t q = 0; q < unmatchedHouses.size(); ++q)
+    {
+        int h = unmatchedHouses[q];
+        while (next[h] < start[h + 1])
+        {
+            int a = requesters[next[h]++];
+            int rank = graph.rank(a, h);
+            if (rank < curRank[a]) // a may have moved above h since it asked
+            {
+                int oldH = matchA[a];
+                matchA[a] = h;
+                matchH[h] = a;
+                matchH[oldH] = 0;
+                curRank[a] = rank;
+                STAT_ADD(tradeInMoves, 1);
+                if (next[oldH] < start[oldH + 1])
+                {
+                    unmatchedHouses.push_back(oldH);
+                }
+                break;
+            }
+        }
+    }
+}
+
+template <class Window>
+void makeTradeInFree(vector<int> &matchA, vector<int> &matchH, const Window &graph)
+{
+    TradeInScratch scratch;
+    makeTradeInFree(matchA, matchH, graph, scratch);
+}
+
+// Agent states during top trading cycles
+enum : char
+{
+    Active,
+    OnPath,
+    Settled
+};
+
+// Per-agent state of top trading cycles, kept from one pass to the next. An entry written in an earlier pass reads
+// as an active agent at the start of its list, so a pass only pays for the agents it reaches, which it lists in
+// 'reached'. The path keeps its capacity as well
+struct TradingScratch
+{
+    struct Entry
+    {
+        int ptr;   // Next preference to look at
+        int pass;  // Pass that wrote the entry
+        char state;
+    };
+    vector<Entry> agent;
+    vector<int> path, reached;
+    int current = 0;
+
+    void begin(int numAgents)
+    {
+        if ((int)agent.size() < numAgents + 1)
+        {
+            agent.resize(numAgents + 1, Entry{0, 0, Active});
+        }
+        if (++current == INT_MAX)
+        {
+            for (Entry &e : agent)
+            {
+                e.pass = 0;
+            }
+            current = 1;
+        }
+        reached.clear();
+    }
+    char state(int a) const { return agent[a].pass == current ? agent[a].state : (char)Active; }
+    bool settled(int a) const { return agent[a].pass == current && agent[a].state == Settled; }
+    // Put a on the path, with its pointer back at the top of its list
+    void enter(int a)
+    {
+        agent[a] = Entry{0, current, OnPath};
+        reached.push_back(a);
+        path.push_back(a);
+    }
+};
+
+// Top trading cycles on an existing matching, in one pass. Every matched agent points to the best house it
+// prefers to its own that is still in play, or to its own house, which settles it. A house is in play while it
+// has a free seat or an agent that is not settled yet, and points to such an agent. Pointers are chased with an
+// explicit path: reaching an agent on the path closes a cycle whose agents swap houses, reaching a free seat
+// moves everyone on the path one house up. Settled agents never come back, so each pointer only moves forward
+// and each preference entry is passed once overall.
+//
+// The market tracks house ownership: hasRoom(h) says h has a free seat, owner(h, scratch) returns an agent of h
+// that is not settled or 0, shift(from, to, a) frees a seat of house 'from' and gives agent a a seat of house 'to'
+// at the end of a path, and finish() brings it back in line with matchA.
+//
+// Paths start from the agents of 'seeds' in order, agents reached from them join in. The market may append
+// seeds while the pass runs. Agents never reached keep their houses, which is enough when only the seeds can
+// be part of a trading cycle
+template <class Window, class Market>
+void topTradingCycles(vector<int> &matchA, const Window &graph, Market &market, const vector<int> &seeds, TradingScratch &scratch)
+{
+    scratch.begin(graph.numAgents);
+    vector<int> &path = scratch.path;
+    for (size_t i = 0; i < seeds.size(); ++i)
+    {
+        int s = seeds[i];
+        if (matchA[s] == 0 || scratch.state(s) != Active)
+        {
+            continue;
+        }
+        scratch.enter(s);
+        while (!path.empty())
+        {
+            int a = path.back();
+            TradingScratch::Entry &e = scratch.agent[a];
+            int h = graph.prefs(a)[e.ptr];
+            if (h == matchA[a])
+            {
+                // Nothing better is left, a keeps its house
+                e.state = Settled;
+                STAT_ADD(agentsSettled, 1);
+                path.pop_back();
+                continue;
+            }
+            if (market.hasRoom(h))
+            {
+                // Everyone on the path moves up, the house of the first agent is freed
+                market.shift(matchA[path[0]], h, a);
+                STAT_ADD(chainsShifted, 1);
+                for (int b : path)
+                {
+                    matchA[b] = graph.prefs(b)[scratch.agent[b].ptr];
+                    scratch.agent[b].state = Settled;
+                }
+                path.clear();
+                continue;
+            }
+            int b = market.owner(h, scratch);
+            if (b == 0)
+            {
+                e.ptr++; // House h has nothing left to trade
+                continue;
+            }
+            if (scratch.state(b) == Active)
+            {
+                scratch.enter(b);
+                continue;
+            }
+
+            // b is on the path, trade along the cycle b -> ... -> a -> b
+            STAT_ADD(cyclesTraded, 1);
+            int i = path.size() - 1;
+            while (path[i] != b)
+            {
+                i--;
+            }
+            for (int j = i; j < (int)path.size(); ++j)
+            {
+                int c = path[j];
+                matchA[c] = graph.prefs(c)[scratch.agent[c].ptr];
+                scratch.agent[c].state = Settled;
+            }
+            path.resize(i);
+        }
+    }
+    market.finish(matchA);
+}
+
+// Top trading cycles from every agent
+template <class Window, class Market>
+void topTradingCycles(vector<int> &matchA, const Window &graph, Market &market)
+{
+    STAT_PHASE("makeCoalitionFree");
+    vector<int> seeds(graph.numAgents);
+    iota(seeds.begin(), seeds.end(), 1);
+    TradingScratch scratch;
+    topTradingCycles(matchA, graph, market, seeds, scratch);
+}
+
+// One agent per house, matchH[h] is the agent of house h
+struct HouseMarket
+{
+    vector<int> &matchH;
+    bool hasRoom(int h) const { return matchH[h] == 0; }
+    int owner(int h, const TradingScratch &scratch) const { return scratch.settled(matchH[h]) ? 0 : matchH[h]; }
+    void shift(int from, int to, int a)
+    {
+        matchH[from] = 0;
+        matchH[to] = a;
+    }
+    void finish(const vector<int> &matchA)
+    {
+        fill(matchH.begin(), matchH.end(), 0);
+        for (int a = 1; a < (int)matchA.size(); ++a)
+        {
+            matchH[matchA[a]] = a;
+        }
+        matchH[0] = 0;
+    }
+};
+
+// Make the matching coalition-free
+template <class Window>
+void makeCoalitionFree(vector<int> &matchA, vector<int> &matchH, const Window &graph)
+{
+    HouseMarket market{matchH};
+    topTradingCycles(matchA, graph, market);
+}
@@ -0,0 +1,100 @@
+#pragma once
+#include "Graph.h"
+#include "Stats.h"
+
+using namespace std;
+
+// Pothen-Fan matching with lookahead and fairness, starting from the given matching. Each phase runs one depth
+// first search from every free agent, houses visited in the phase are not entered again. Before going deeper an
+// agent looks ahead for a free house in its list: lookahead[a] only moves forward over the whole run, since a
+// matched house never becomes free again. Phases scan the lists alternately from the front and from the back.
+// Returns the number of augmentations, stops after a phase that finds none
+template <class Window>
+int pothenFan(const Window &graph, vector<int> &matchA, vector<int> &matchH)
+{
+    vector<int> lookahead(graph.numAgents + 1, 0), it(graph.numAgents + 1);
+    vector<int> visited(graph.numHouses + 1, 0); // Phase in which each house was last entered
+    vector<int> path, via;                       // Agents on the search path and the house each one moves to
+
+    int augmented = 0;
+    for (int phase = 1;; ++phase)
+    {
+        bool forward = phase % 2 == 1;
+        int found = 0;
+        for (int a = 1; a <= graph.numAgents; ++a)
+        {
+            it[a] = forward ? 0 : graph.prefs(a).size();
+        }
+        for (int root = 1; root <= graph.numAgents; ++root)
+        {
+            if (matchA[root] != 0)
+            {
+                continue;
+            }
+            path.assign(1, root);
+            via.clear();
+            while (!path.empty())
+            {
+                int a = path.back();
+                auto prefs = graph.prefs(a);
+                int next = -1; // 0 once a free house is taken, else the agent to displace
+
+                for (; lookahead[a] < (int)prefs.size(); lookahead[a]++)
+                {
+                    int h = prefs[lookahead[a]];
+                    if (matchH[h] == 0 && visited[h] != phase)
+                    {
+                        visited[h] = phase;
+                        via.push_back(h);
+                        next = 0;
+                        break;
+                    }
+                }
+                while (next == -1 && (forward ? it[a] < (int)prefs.size() : it[a] > 0))
+                {
+                    int h = forward ? prefs[it[a]++] : prefs[--it[a]];
+                    STAT_ADD(dfsEdgeVisits, 1);
+                    if (visited[h] == phase)
+                    {
+                        continue;
+                    }
+                    visited[h] = phase;
+                    via.push_back(h);
+                    next = matchH[h];
+                }
+
+                if (next == -1)
+                {
+                    // Every house reachable from a was visited, retreat
+                    path.pop_back();
+                    if (!via.empty())
+                    {
+                        via.pop_back();
+                    }
+                }
+                else if (next == 0)
+                {
+                    STAT_ADD(augmentations, 1);
+                    STAT_ADD(pathLengthTotal, path.size());
+                    STAT_MAX(pathLengthMax, path.size());
+                    for (size_t i = 0; i < path.size(); ++i)
+                    {
+                        matchA[path[i]] = via[i];
+                        matchH[via[i]] = path[i];
+                    }
+                    found++;
+                    break;
+                }
+                else
+                {
+                    path.push_back(next);
+                }
+            }
+        }
+        augmented += found;
+        if (found == 0)
+        {
+            return augmented;
+        }
+    }
+}
@@ -0,0 +1,109 @@
+#pragma once
+#include "Graph.h"
+#include "Stats.h"
+
+using namespace std;
+
+// Push-relabel matching, starting from the given matching. label[h] is a lower bound on the number of
+// matched edges between house h and a free house along an alternating path, numHouses or more when there is
+// none. A free agent takes its neighbour of least label, displacing the agent there, which becomes free in turn
+// (double push), and raises the label of that house to one more than its second best. Global relabeling
+// recomputes exact labels with a BFS from the free houses every numAgents + numHouses pushes.
+// An agent whose best label is unreachable cannot be matched and is dropped. Returns the number of agents added
+template <class Window>
+int pushRelabel(const Window &graph, vector<int> &matchA, vector<int> &matchH)
+{
+    HouseIndex index(graph);
+    const int unreachable = graph.numHouses;
+    vector<int> label(graph.numHouses + 1);
+    vector<int> queueH;
+
+    auto globalRelabel = [&]()
+    {
+        queueH.clear();
+        for (int h = 1; h <= graph.numHouses; ++h)
+        {
+            label[h] = matchH[h] == 0 ? 0 : unreachable;
+            if (matchH[h] == 0)
+            {
+                queueH.push_back(h);
+            }
+        }
+        for (size_t i = 0; i < queueH.size(); ++i)
+        {
+            int h = queueH[i];
+            for (auto j = index.start[h]; j < index.start[h + 1]; ++j)
+            {
+                int other = matchA[index.agents[j]];
+                if (other != 0 && label[other] == unreachable)
+                {
+                    label[other] = label[h] + 1;
+                    queueH.push_back(other);
+                }
+            }
+        }
+    };
+
+    int matched = 0;
+    queue<int> active;
+    for (int a = 1; a <= graph.numAgents; ++a)
+    {
+        if (matchA[a] == 0)
+        {
+            active.push(a);
+        }
+        else
+        {
+            matched++;
+        }
+    }
+    int before = matched;
+
+    globalRelabel();
+    long long pushes = 0;
+    while (!active.empty())
+    {
+        int a = active.front();
+        active.pop();
+        int best = 0, first = INT_MAX, second = INT_MAX;
+        for (int h : graph.prefs(a))
+        {
+            STAT_ADD(dfsEdgeVisits, 1);
+            if (label[h] < first)
+            {
+                second = first;
+                first = label[h];
+                best = h;
+            }
+            else if (label[h] < second)
+            {
+                second = label[h];
+            }
+        }
+        if (first >= unreachable)
+        {
+            continue; // No alternating path to a free house
+        }
+
+        int b = matchH[best];
+        matchA[a] = best;
+        matchH[best] = a;
+        label[best] = second == INT_MAX ? unreachable : min(second + 1, unreachable);
+        if (b != 0)
+        {
+            matchA[b] = 0;
+            active.push(b);
+        }
+        else
+        {
+            matched++;
+            STAT_ADD(augmentations, 1);
+        }
+
+        if (++pushes % (graph.numAgents + graph.numHouses) == 0)
+        {
+            globalRelabel();
+        }
+    }
+    return matched - before;
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include "Matching_Engine.h"
+#include "Output.h"
+
+using namespace std;
+
+// Command line shared by the solver programs:
+//   --threads N | --format text|tsv|binary | --engine hopcroft-karp|push-relabel|pothen-fan | --batch | --batch-dir DIR
+struct SolverOptions
+{
+    int threads = 1; // N = 0 uses every core
+    OutputFormat format = OutputFormat::Text;
+    MatchingEngine engine = MatchingEngine::HopcroftKarp;
+    bool batch = false; // Set by --batch-dir too
+    string batchDir;
+};
+
+// Parse argv into options. 'switches' are the flags a program adds of its own, set when given, and --engine is
+// only known to programs that pick a matching engine. An unknown option, or one with a missing or bad value,
+// prints what is wrong and 'usage' to stderr and returns false
+bool parseSolverOptions(int argc, char **argv, const string &usage, SolverOptions &options,
+                        const vector<pair<string, bool *>> &switches = {}, bool withEngine = true)
+{
+    auto reject = [&](const string &problem)
+    {
+        cerr << problem << endl
+             << "Usage: " << usage << endl;
+        return false;
+    };
+    for (int i = 1; i < argc; ++i)
+    {
+        string option = argv[i];
+        auto own = find_if(switches.begin(), switches.end(), [&](const pair<string, bool *> &s)
+                           { return s.first == option; });
+        if (own != switches.end())
+        {
+            *own->second = true;
+            continue;
+        }
+        if (option == "--batch")
+        {
+            options.batch = true;
+            continue;
+        }
+        if (option != "--threads" && option != "--format" && option != "--batch-dir" && !(withEngine && option == "--engine"))
+        {
+            return reject("Unknown option: " + option);
+        }
+        if (i + 1 == argc)
+        {
+            return reject("Missing value for " + option);
+        }
+        string value = argv[++i];
+        if (option == "--threads")
+        {
+            auto [end, ec] = from_chars(value.data(), value.data() + value.size(), options.threads);
+            if (ec != errc() || end != value.data() + value.size())
+            {
+                return reject("Invalid thread count: " + value);
+            }
+        }
+        else if (option == "--format" && !parseOutputFormat(value, options.format))
+        {
+            return reject("Unknown output format: " + value);
+        }
+        else if (option == "--engine" && !parseMatchingEngine(value, options.engine))
+        {
+            return reject("Unknown matching engine: " + value);
+        }
+        else if (option == "--batch-dir")
+        {
+            options.batch = true;
+            options.batchDir = value;
+        }
+    }
+    if (options.threads <= 0)
+    {
+        options.threads = max(1u, thread::hardware_concurrency());
+    }
+    return true;
+}
@@ -0,0 +1,204 @@
+#pragma once
+#include "Pareto.h"
+
+using namespace std;
+
+// Threads parked between the parallel sections of a solver run, so a section costs a wake-up instead of
+// starting and joining threads. The pool grows to the largest thread count asked for
+class WorkerPool
+{
+public:
+    WorkerPool() = default;
+    WorkerPool(const WorkerPool &) = delete;
+    WorkerPool &operator=(const WorkerPool &) = delete;
+    ~WorkerPool()
+    {
+        {
+            lock_guard<mutex> guard(lock);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (thread &t : workers)
+        {
+            t.join();
+        }
+    }
+
+    // Run job(t) for t = 0 .. threads - 1, job(0) on the calling thread, and return once every one is done
+    void run(int threads, const function<void(int)> &job)
+    {
+        {
+            lock_guard<mutex> guard(lock);
+            while ((int)workers.size() < threads - 1)
+            {
+                workers.emplace_back(&WorkerPool::loop, this, (int)workers.size() + 1, generation);
+            }
+            current = &job;
+            active = threads;
+            pending = threads - 1;
+            generation++;
+        }
+        wake.notify_all();
+        job(0);
+        unique_lock<mutex> guard(lock);
+        done.wait(guard, [&]
+                  { return pending == 0; });
+    }
+
+private:
+    vector<thread> workers;
+    mutex lock;
+    condition_variable wake, done;
+    const function<void(int)> *current = nullptr;
+    int active = 0, pending = 0;
+    long long generation = 0;
+    bool stopping = false;
+
+    // Worker t runs each job handed out after 'seen' while t is below the thread count of the job
+    void loop(int t, long long seen)
+    {
+        while (true)
+        {
+            const function<void(int)> *job;
+            {
+                unique_lock<mutex> guard(lock);
+                wake.wait(guard, [&]
+                          { return stopping || generation != seen; });
+                if (stopping)
+                {
+                    return;
+                }
+                seen = generation;
+                if (t >= active)
+                {
+                    continue;
+                }
+                job = current;
+            }
+            (*job)(t);
+            lock_guard<mutex> guard(lock);
+            if (--pending == 0)
+            {
+                done.notify_one();
+            }
+        }
+    }
+};
+
+// State of parallel Hopcroft-Karp kept in a workspace. The house index holds a (rank, agent) pair for every agent
+// ranking house h in the whole graph, entries[start[h]] .. entries[start[h + 1] - 1] sorted by rank, so a window
+// of that graph reads a prefix of them instead of building its own. It is built again when the generation of the
+// graph changes, which it does for another graph and for the same one indexed again after a change. Claim stamps
+// stay valid across calls as phases keep counting up
+struct ParallelScratch
+{
+    WorkerPool pool;
+    vector<int64_t> start;
+    vector<pair<int, int>> entries;
+    vector<int> dist, it, path, claimA, claimH, retry;
+    int base = 1; // Layers in dist are numbered from here, see parallelBfs
+    int phase = 0;
+
+    // Size the buffers for graph, the whole graph behind the windows to be matched, and index its houses
+    template <class G>
+    void prepare(const G &graph)
+    {
+        int numAgents = graph.numAgents, numHouses = graph.numHouses;
+        if ((int)dist.size() < numAgents + 1)
+        {
+            dist.resize(numAgents + 1, 0); // Below base, unreached
+            it.resize(numAgents + 1);
+            claimA.resize(numAgents + 1, 0);
+        }
+        if ((int)claimH.size() < numHouses + 1)
+        {
+            claimH.resize(numHouses + 1, 0);
+        }
+        if (phase == INT_MAX)
+        {
+            fill(claimA.begin(), claimA.end(), 0);
+            fill(claimH.begin(), claimH.end(), 0);
+            phase = 0;
+        }
+        if (indexed != 0 && indexed == graph.generation())
+        {
+            return;
+        }
+        start.assign(numHouses + 2, 0);
+        for (int a = 1; a <= numAgents; ++a)
+        {
+            for (int h : graph.prefs(a))
+            {
+                start[h + 1]++;
+            }
+        }
+        partial_sum(start.begin(), start.end(), start.begin());
+        entries.resize(start.back());
+        // Counting sort by rank: the agents with a rank r entry are listed rank by rank, then their entries are
+        // placed in that order, so each house gets its entries sorted without comparing them
+        vector<int64_t> byRankStart(1, 0);
+        for (int a = 1; a <= numAgents; ++a)
+        {
+            for (int r = 0; r < graph.degree(a); ++r)
+            {
+                if (r + 1 == (int)byRankStart.size())
+                {
+                    byRankStart.push_back(0);
+                }
+                byRankStart[r + 1]++;
+            }
+        }
+        partial_sum(byRankStart.begin(), byRankStart.end(), byRankStart.begin());
+        vector<int> byRank(byRankStart.back());
+        vector<int64_t> cursor(byRankStart.begin(), byRankStart.end() - 1);
+        for (int a = 1; a <= numAgents; ++a)
+        {
+            for (int r = 0; r < graph.degree(a); ++r)
+            {
+                byRank[cursor[r]++] = a;
+            }
+        }
+        cursor.assign(start.begin(), start.end() - 1);
+        for (int r = 0; r + 1 < (int)byRankStart.size(); ++r)
+        {
+            for (int64_t j = byRankStart[r]; j < byRankStart[r + 1]; ++j)
+            {
+                int a = byRank[j], h = graph.prefs(a)[r];
+                entries[cursor[h]++] = {r, a};
+            }
+        }
+        indexed = graph.generation();
+    }
+
+private:
+    uint64_t indexed = 0; // Generation of the graph the house index belongs to
+};
+
+// Buffers of a solver run, sized once from the instance by prepare and reused by every probe and phase after
+// that, so the run allocates nothing more. A workspace kept from one instance to the next only grows. The
+// matching being probed and the best one found so far live side by side, results are swapped out of them
+struct SolverWorkspace
+{
+    vector<int> dist, it, path, queue;           // Serial Hopcroft-Karp layering and searches
+    int base = 1;                                // Layers in dist are numbered from here, see bfs
+    vector<int> matchA, matchH;                  // Matching being probed
+    vector<int> bestA, bestH;                    // Best matching found so far
+    TradeInScratch tradeIn;                      // Requester lists of makeTradeInFree
+    ParallelScratch parallel;                    // Index, claims and threads of parallel Hopcroft-Karp
+    vector<unique_ptr<SolverWorkspace>> helpers; // Workspaces of the other threads of minSpread
+
+    void prepare(int numAgents, int numHouses)
+    {
+        if ((int)dist.size() < numAgents + 1)
+        {
+            dist.resize(numAgents + 1, 0); // Below base, unreached
+            it.resize(numAgents + 1);
+        }
+        path.reserve(numAgents + 1);
+        queue.reserve(numAgents + 1);
+        matchA.reserve(numAgents + 1);
+        bestA.reserve(numAgents + 1);
+        matchH.reserve(numHouses + 1);
+        bestH.reserve(numHouses + 1);
+    }
+};
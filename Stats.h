@@ -0,0 +1,93 @@
+#pragma once
+#include <bits/stdc++.h>
+
+using namespace std;
+
+// Instrumentation of the matching code, compiled in with -DMATCHING_STATS. Without it every macro below
+// expands to nothing, so the counters cost nothing in normal builds.
+//   STAT_ADD(counter, n)  adds n to a counter, safe from several threads
+//   STAT_MAX(counter, n)  raises a counter to at least n
+//   STAT_PHASE(name)      times the enclosing scope, times of the same name add up
+//   reportStats()         writes everything as one JSON object to stderr
+#ifdef MATCHING_STATS
+
+struct MatchingStats
+{
+    atomic<long long> hkPhases{0};         // BFS rounds of Hopcroft-Karp that found augmenting paths
+    atomic<long long> bfsLayers{0};        // Layers of those rounds, summed
+    atomic<long long> augmentations{0};    // Augmenting paths applied
+    atomic<long long> pathLengthTotal{0};  // Agents on those paths, summed
+    atomic<long long> pathLengthMax{0};    // Agents on the longest one
+    atomic<long long> dfsEdgeVisits{0};    // Preference entries looked at by the path searches
+    atomic<long long> windowProbes{0};     // Rank windows augmented by leastDissatisfaction and minSpread
+    atomic<long long> tradeInMoves{0};     // Agents moved to a free house by makeTradeInFree
+    atomic<long long> cyclesTraded{0};     // Cycles executed by makeCoalitionFree
+    atomic<long long> chainsShifted{0};    // Paths ending at a free seat shifted by makeCoalitionFree
+    atomic<long long> agentsSettled{0};    // Agents keeping their house in makeCoalitionFree
+
+    mutex lock;
+    vector<pair<string, double>> phaseSeconds; // In order of first use
+};
+
+MatchingStats matchingStats;
+
+class PhaseTimer
+{
+public:
+    explicit PhaseTimer(const char *name) : name(name), start(chrono::steady_clock::now()) {}
+    ~PhaseTimer()
+    {
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        lock_guard<mutex> guard(matchingStats.lock);
+        auto &phases = matchingStats.phaseSeconds;
+        auto it = find_if(phases.begin(), phases.end(), [&](const pair<string, double> &p)
+                          { return p.first == name; });
+        if (it == phases.end())
+            phases.push_back({name, seconds});
+        else
+            it->second += seconds;
+    }
+
+private:
+    const char *name;
+    chrono::steady_clock::time_point start;
+};
+
+void reportStats()
+{
+    MatchingStats &s = matchingStats;
+    lock_guard<mutex> guard(s.lock);
+    fprintf(stderr, "{\"phases\":{");
+    for (size_t i = 0; i < s.phaseSeconds.size(); ++i)
+    {
+        fprintf(stderr, "%s\"%s\":%.6f", i ? "," : "", s.phaseSeconds[i].first.c_str(), s.phaseSeconds[i].second);
+    }
+    fprintf(stderr,
+            "},\"counters\":{\"hkPhases\":%lld,\"bfsLayers\":%lld,\"augmentations\":%lld,\"pathLengthTotal\":%lld,"
+            "\"pathLengthMax\":%lld,\"dfsEdgeVisits\":%lld,\"windowProbes\":%lld,\"tradeInMoves\":%lld,"
+            "\"cyclesTraded\":%lld,\"chainsShifted\":%lld,\"agentsSettled\":%lld}}\n",
+            s.hkPhases.load(), s.bfsLayers.load(), s.augmentations.load(), s.pathLengthTotal.load(),
+            s.pathLengthMax.load(), s.dfsEdgeVisits.load(), s.windowProbes.load(), s.tradeInMoves.load(),
+            s.cyclesTraded.load(), s.chainsShifted.load(), s.agentsSettled.load());
+}
+
+#define STAT_ADD(counter, n) matchingStats.counter.fetch_add((n), memory_order_relaxed)
+#define STAT_MAX(counter, n)                                                                                  \
+    do                                                                                                        \
+    {                                                                                                         \
+        long long statValue = (n), statOld = matchingStats.counter.load(memory_order_relaxed);                \
+        while (statOld < statValue && !matchingStats.counter.compare_exchange_weak(statOld, statValue))       \
+            ;                                                                                                 \
+    } while (0)
+#define STAT_CONCAT2(a, b) a##b
+#define STAT_CONCAT(a, b) STAT_CONCAT2(a, b)
+#define STAT_PHASE(name) PhaseTimer STAT_CONCAT(phaseTimer, __LINE__)(name)
+
+#else
+
+#define STAT_ADD(counter, n) ((void)0)
+#define STAT_MAX(counter, n) ((void)0)
+#define STAT_PHASE(name) ((void)0)
+void reportStats() {}
+
+#endif
@@ -0,0 +1,117 @@
+#pragma once
+#include "Graph.h"
+#include "Stats.h"
+
+using namespace std;
+
+// Near-maximum starting matching in linear time, added to the given one. Karp-Sipser first: an agent or a house
+// left with a single free neighbour is matched to it, which is always part of some maximum matching, and the
+// degrees of the neighbours drop in turn. The rest is matched greedily, each free agent taking its most
+// preferred free house. Returns the number of pairs added
+template <class Window>
+int warmStart(const Window &graph, vector<int> &matchA, vector<int> &matchH)
+{
+    STAT_PHASE("warmStart");
+    HouseIndex ranking(graph);
+    vector<int> degA(graph.numAgents + 1, 0), degH(graph.numHouses + 1, 0);
+    vector<int> single; // Agents as a, houses as -h, that may have one free neighbour left
+    for (int a = 1; a <= graph.numAgents; ++a)
+    {
+        if (matchA[a] != 0)
+        {
+            continue;
+        }
+        for (int h : graph.prefs(a))
+        {
+            if (matchH[h] == 0)
+            {
+                degA[a]++;
+                degH[h]++;
+            }
+        }
+    }
+    for (int a = 1; a <= graph.numAgents; ++a)
+    {
+        if (degA[a] == 1)
+        {
+            single.push_back(a);
+        }
+    }
+    for (int h = 1; h <= graph.numHouses; ++h)
+    {
+        if (degH[h] == 1)
+        {
+            single.push_back(-h);
+        }
+    }
+
+    int added = 0;
+    auto match = [&](int a, int h)
+    {
+        matchA[a] = h;
+        matchH[h] = a;
+        added++;
+        for (int g : graph.prefs(a))
+        {
+            if (matchH[g] == 0 && --degH[g] == 1)
+            {
+                single.push_back(-g);
+            }
+        }
+        for (auto j = ranking.start[h]; j < ranking.start[h + 1]; ++j)
+        {
+            int b = ranking.agents[j];
+            if (matchA[b] == 0 && --degA[b] == 1)
+            {
+                single.push_back(b);
+            }
+        }
+    };
+
+    while (!single.empty())
+    {
+        int v = single.back();
+        single.pop_back();
+        if (v > 0 && matchA[v] == 0)
+        {
+            for (int h : graph.prefs(v))
+            {
+                if (matchH[h] == 0)
+                {
+                    match(v, h);
+                    break;
+                }
+            }
+        }
+        else if (v < 0 && matchH[-v] == 0)
+        {
+            for (auto j = ranking.start[-v]; j < ranking.start[-v + 1]; ++j)
+            {
+                if (matchA[ranking.agents[j]] == 0)
+                {
+                    match(ranking.agents[j], -v);
+                    break;
+                }
+            }
+        }
+    }
+
+    for (int a = 1; a <= graph.numAgents; ++a)
+    {
+        if (matchA[a] != 0)
+        {
+            continue;
+        }
+        for (int h : graph.prefs(a))
+        {
+            if (matchH[h] == 0)
+            {
+                matchA[a] = h;
+                matchH[h] = a;
+                added++;
+                break;
+            }
+        }
+    }
+    return added;
+}